@@ -1,6 +1,20 @@
-""" TTT-Arduino Host (algorithm and other memory-intensive tasks) """
+""" TTT-Arduino Host (algorithm and other memory-intensive tasks)
+
+The machine's moves come from the engine of ttt-alg.cpp, loaded as a shared
+library from next to this file, or from the path in TTT_LIBRARY. Build it
+from this directory with
+
+    g++ -std=c++14 -O2 -fPIC -shared -fvisibility=hidden -DCOMPILE_LIBRARY \
+        -o libttt.so ttt-alg.cpp -pthread
+
+Without the library, the minimax below plays instead. Run with --bench to time
+the two against each other. """
 import copy
+import ctypes
+import json
+import os
 import random
+import sys
 import time
 
 machine_char = ''
@@ -112,6 +126,14 @@ def mm(board, depth, ismachine):
     best_score_index = mm_sel_rand(scores, max if ismachine else min)
     return (scores[best_score_index], moves[best_score_index])
 
+def user_choice(board):
+    """ Returns the cell the user chooses, asking again until it is vacant. """
+    while True:
+        choice = input("Your choice index ->")
+        if choice.strip().isdigit() and int(choice) in board_vacant_cells(board):
+            return int(choice)
+        print("That cell is not vacant!")
+
 def interactive(machine_first):
     """ The main interactive program for testing minimax. """
     global machine_char
@@ -121,16 +143,158 @@ def interactive(machine_first):
     while board_winner(board) == ' ' and not board_filled(board):
         if machine_turn:
             begin_time = time.time()
-            board[mm(board, 0, True)[1]] = machine_char
+            board[machine_move(board)] = machine_char
             print("Solution obtained in {} milliseconds".format(
                 (time.time()-begin_time)*1000))
         else:
-            board[int(input("Your choice index ->"))] = \
-                    board_other(machine_char)
+            board[user_choice(board)] = board_other(machine_char)
         board_print(board)
         machine_turn = not machine_turn
 
+# Engine library subsection
+
+# the version of the library's functions this file calls
+ENGINE_ABI_VERSION = 1
+
+# what the library gives cells that aren't moves
+ENGINE_NO_SCORE = -2 ** 31
+
+# the strategy and limits of the machine's moves: impossible, searching at
+# most a second and any number of nodes, as ttt-alg.cpp plays by default
+ENGINE_DIFFICULTY = 2
+ENGINE_MOVE_TIME = 1000
+ENGINE_MOVE_NODES = 0
+
+def engine_load():
+    """ Returns the engine library with its functions declared, or None if
+        none can be loaded. """
+    if 'TTT_LIBRARY' in os.environ:
+        paths = [os.environ['TTT_LIBRARY']]
+    else:
+        here = os.path.dirname(os.path.abspath(__file__))
+        paths = [os.path.join(here, name)
+                 for name in ('libttt.so', 'libttt.dylib', 'ttt.dll')]
+    for path in paths:
+        try:
+            library = ctypes.CDLL(path)
+        except OSError:
+            continue
+        if library.ttt_abi_version() != ENGINE_ABI_VERSION:
+            continue
+        shape = [ctypes.c_int] * 3
+        library.ttt_best_move.argtypes = [ctypes.c_char_p] + shape + [
+            ctypes.c_int, ctypes.c_int64, ctypes.c_uint64, ctypes.c_uint64]
+        library.ttt_best_move.restype = ctypes.c_int
+        library.ttt_evaluate.argtypes = [ctypes.c_char_p] + shape + [
+            ctypes.c_int64, ctypes.c_uint64, ctypes.POINTER(ctypes.c_int32)]
+        library.ttt_evaluate.restype = ctypes.c_int
+        library.ttt_evaluate_batch.argtypes = [
+            ctypes.c_char_p, ctypes.c_uint64] + shape + [
+                ctypes.c_int64, ctypes.c_uint64, ctypes.c_uint64,
+                ctypes.POINTER(ctypes.c_int32), ctypes.POINTER(ctypes.c_int32)]
+        library.ttt_evaluate_batch.restype = ctypes.c_int64
+        return library
+    return None
+
+ENGINE = engine_load()
+
+def engine_board(board):
+    """ Returns the board as the bytes the library takes. """
+    return ''.join(board).encode('ascii')
+
+def engine_move(board):
+    """ Returns the engine's move for the player to move on the board, or None
+        if the game is over. Its random choices follow the random module. """
+    move = ENGINE.ttt_best_move(engine_board(board), 3, 3, 3,
+                                ENGINE_DIFFICULTY, ENGINE_MOVE_TIME,
+                                ENGINE_MOVE_NODES, random.getrandbits(64))
+    return None if move < 0 else move
+
+def engine_evaluate(board):
+    """ Returns the score of every cell of the board for the player to move,
+        None for cells that aren't moves. Scores are 10 - plies for a win,
+        plies - 10 for a loss and 0 for a draw; moves that can't beat the best
+        get an upper bound of their score. """
+    scores = (ctypes.c_int32 * 9)()
+    if ENGINE.ttt_evaluate(engine_board(board), 3, 3, 3, ENGINE_MOVE_TIME,
+                           ENGINE_MOVE_NODES, scores) < 0:
+        raise ValueError("invalid board")
+    return [None if score == ENGINE_NO_SCORE else score for score in scores]
+
+def engine_evaluate_batch(boards):
+    """ Returns the engine's move and its score for each of the boards, searched
+        in parallel, with a move of None once the game is over. """
+    count = len(boards)
+    moves = (ctypes.c_int32 * count)()
+    scores = (ctypes.c_int32 * count)()
+    if ENGINE.ttt_evaluate_batch(b''.join(engine_board(b) for b in boards),
+                                 count, 3, 3, 3, ENGINE_MOVE_TIME,
+                                 ENGINE_MOVE_NODES, random.getrandbits(64),
+                                 moves, scores) != 0:
+        raise ValueError("invalid board")
+    return [(None if move < 0 else move, score)
+            for move, score in zip(moves, scores)]
+
+def machine_move(board):
+    """ Returns the machine's move on the board, from the engine library if it
+        was loaded and takes the board, or from minimax otherwise. """
+    move = engine_move(board) if ENGINE else None
+    if move is None:
+        move = mm(board, 0, True)[1]
+    return move
+
+# Benchmark subsection
+
+def bench_report(name, ops, seconds):
+    """ Prints the time per operation in the JSON lines of ttt-alg.cpp's
+        benchmarks. """
+    print(json.dumps({'benchmark': name, 'ops': ops,
+                      'ns_per_op': round(seconds * 1e9 / ops, 3)}))
+
+def bench_time(function, ops):
+    """ Returns the seconds it takes to call the function ops times. """
+    begin = time.perf_counter()
+    for _ in range(ops):
+        function()
+    return time.perf_counter() - begin
+
+def benchmark():
+    """ Times the machine's first move, and the moves of every position two
+        plies in, with minimax and with the engine library. """
+    global machine_char
+    machine_char = 'x'
+    empty = board_clean()
+    openings = []
+    for first in range(9):
+        for second in range(9):
+            if first != second:
+                board = board_clean()
+                board[first], board[second] = 'x', 'o'
+                openings.append(board)
+
+    bench_report('first_move/python', 1,
+                 bench_time(lambda: mm(empty, 0, True), 1))
+    begin = time.perf_counter()
+    for board in openings:
+        mm(board, 0, True)
+    bench_report('openings/python', len(openings), time.perf_counter() - begin)
+    if not ENGINE:
+        print("The engine library isn't loaded, so only minimax is timed",
+              file=sys.stderr)
+        return
+    bench_report('first_move/native', 1000,
+                 bench_time(lambda: engine_move(empty), 1000))
+    begin = time.perf_counter()
+    for board in openings:
+        engine_move(board)
+    bench_report('openings/native', len(openings), time.perf_counter() - begin)
+    bench_report('openings/native_batch', len(openings) * 100,
+                 bench_time(lambda: engine_evaluate_batch(openings), 100))
+
 # run this for interactive
 if __name__ == '__main__':
+    if '--bench' in sys.argv[1:]:
+        benchmark()
+        sys.exit(0)
     mf = input("Machine first? [0,1]")
     interactive(mf == '1')
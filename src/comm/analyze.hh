@@ -0,0 +1,195 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  analyze.hh
+ *
+ *    Description:  Headless analysis mode: positions in, best moves and scores out
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:31:50 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_COMM_ANALYZE
+#define TTT_COMM_ANALYZE
+
+#include <cstdio>
+
+/* ========== Analysis Records ========== */
+
+// positions read, analyzed and written at a time, a whole number of board
+// blocks, and positions per pool task
+#define ANALYZE_CHUNK 4096
+#define ANALYZE_TASK 64
+
+// longest output line: the board, every cell as a best move ("48,"), and
+// the score
+template <class G>
+constexpr size_t ANALYZE_LINE = G::CELLS * 4 + 16;
+
+// a position of the input and its line of output
+template <class G>
+struct AnalyzeRecord {
+	BitBoard<G> board;
+	bool valid;
+	unsigned short length;
+	char line[ANALYZE_LINE<G>];
+};
+
+// reads a board written by board_to_string, one cell per char, where ' ', '.',
+// '-' and '_' are empty. returns false unless the line has exactly one char
+// per cell and the marks could come from a real game, as is_reachable judges.
+// so each of these classic lines analyzes as "invalid":
+//   "xxxooo   "   both players have a line
+//   "oooxx xx "   o has a line, but x moved last
+//   "xxxoo  o "   x has a line, but o moved last
+//   "xx       "   x is two marks ahead
+template <class G>
+bool parse_text_board(const char* line, size_t length, BitBoard<G>& board)
+{
+	while (length > 0 && (line[length-1] == '\n' || line[length-1] == '\r'))
+		--length;
+	if (length != G::CELLS)
+		return false;
+
+	board = clean_board<G>();
+	for (size_t i = 0; i < G::CELLS; ++i) {
+		switch (line[i]) {
+			case 'x':
+			case 'o':
+				place(board, line[i], i);
+				break;
+			case ' ':
+			case '.':
+			case '-':
+			case '_':
+				break;
+			default:
+				return false;
+		}
+	}
+	return is_reachable(board);
+}
+
+/* ========== Analysis ========== */
+
+// analyzes the position of the record and writes its line of output:
+//   board<TAB>best moves<TAB>score
+// the best moves are cell indexes joined by commas, or '-' once the game is
+// over. the score is from the view of the player to move: WIN - plies for a
+// win, plies - WIN for a loss, 0 for a draw, followed by '?' when the search
+// ran out of limits and had to estimate. invalid input gives a line of
+// "invalid" instead
+template <class G>
+void analyze_record(AnalyzeRecord<G>& record, char winner,
+		const GameSettings& settings, uint64_t seed)
+{
+	char* out = record.line;
+	if (!record.valid) {
+		const char invalid[] = "invalid\n";
+		out = copy(invalid, invalid + sizeof invalid - 1, out);
+		record.length = out - record.line;
+		return;
+	}
+
+	Board<G> cells = to_board(record.board);
+	out = copy(cells.begin(), cells.end(), out);
+	*out++ = '\t';
+	if (winner != ' ' || is_full(record.board)) {
+		*out++ = '-';
+		*out++ = '\t';
+		// whoever made the last move won it
+		out = write_number(out, winner == ' ' ? 0 : -int(G::WIN));
+	} else {
+		SearchLimits limits(settings.move_time, settings.move_nodes, seed);
+		limits.parallel = false;
+		minimax(record.board, limits);
+		const SearchResult& result = limits.result;
+		for (uint64_t moves = result.best_moves; moves; moves &= moves - 1) {
+			out = write_number(out, lowest_cell(moves));
+			if (moves & (moves - 1))
+				*out++ = ',';
+		}
+		*out++ = '\t';
+		out = write_number(out, result.score);
+		if (!result.exact)
+			*out++ = '?';
+	}
+	*out++ = '\n';
+	record.length = out - record.line;
+}
+
+// reads positions from in until it ends, and writes one line of analysis per
+// position to out, in the order of the input. positions are read as text lines
+// unless packed. each position gets the move time and nodes of the settings,
+// and chunks of positions are analyzed in parallel on the search pool.
+// returns the number of invalid positions
+template <class G>
+unsigned long analyze_positions(FILE* in, FILE* out, bool packed,
+		const GameSettings& settings)
+{
+	static char in_buffer[1 << 16], out_buffer[1 << 16];
+	setvbuf(in, in_buffer, _IOFBF, sizeof in_buffer);
+	setvbuf(out, out_buffer, _IOFBF, sizeof out_buffer);
+
+	// static, since it is too large for the stack
+	static AnalyzeRecord<G> records[ANALYZE_CHUNK];
+	static BoardBlock<G> blocks[ANALYZE_CHUNK / BATCH_BOARDS];
+	static char winners[ANALYZE_CHUNK];
+	unsigned long invalid = 0, position = 0;
+	for (;;) {
+		size_t count = 0;
+		char line[ANALYZE_LINE<G>];
+		unsigned char bytes[2 * sizeof(typename G::Mask)];
+		for (; count < ANALYZE_CHUNK; ++count) {
+			AnalyzeRecord<G>& record = records[count];
+			if (packed) {
+				if (fread(bytes, sizeof bytes, 1, in) != 1)
+					break;
+				record.valid = decode_masks(bytes, record.board);
+			} else {
+				if (!fgets(line, sizeof line, in))
+					break;
+				size_t length = strlen(line);
+				record.valid = parse_text_board(line, length, record.board);
+				// the rest of a line too long for the buffer is dropped
+				if (length > 0 && line[length-1] != '\n')
+					for (int c; (c = fgetc(in)) != EOF && c != '\n';)
+						;
+			}
+			if (!record.valid)
+				record.board = clean_board<G>();
+			blocks[count / BATCH_BOARDS].x[count % BATCH_BOARDS] = record.board.x;
+			blocks[count / BATCH_BOARDS].o[count % BATCH_BOARDS] = record.board.o;
+		}
+		if (count == 0)
+			break;
+
+		// the boards left in the last block from an earlier chunk get winners
+		// that are never read
+		block_winners(blocks, (count + BATCH_BOARDS - 1) / BATCH_BOARDS, winners);
+		auto analyze_task = [&](size_t task) {
+			size_t end = min(count, (task + 1) * ANALYZE_TASK);
+			for (size_t i = task * ANALYZE_TASK; i < end; ++i)
+				analyze_record(records[i], winners[i], settings,
+						settings.seed + position + i);
+		};
+		search_pool().run((count + ANALYZE_TASK - 1) / ANALYZE_TASK, analyze_task);
+
+		for (size_t i = 0; i < count; ++i) {
+			fwrite(records[i].line, 1, records[i].length, out);
+			invalid += !records[i].valid;
+		}
+		position += count;
+	}
+	fflush(out);
+	return invalid;
+}
+
+#endif
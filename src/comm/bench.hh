@@ -0,0 +1,259 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bench.hh
+ *
+ *    Description:  Microbenchmarks of the engine primitives, built with COMPILE_BENCH
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 07:10:52 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_COMM_BENCH
+#define TTT_COMM_BENCH
+
+/* ========== Harness ========== */
+
+// repetitions run and thrown away before measuring, and repetitions measured
+#define BENCH_WARMUP 2
+#define BENCH_REPS 9
+
+// makes the compiler believe the value is used, so the work producing it
+// can't be optimized away
+template <class T>
+inline void bench_keep(const T& value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+// runs setup and then ops calls of body(i) per repetition, timing only the
+// calls, and prints one JSON line: the median and fastest nanoseconds per
+// op, the search nodes per second and the heap allocations per op over the
+// measured repetitions
+template <class Setup, class Body>
+void bench(const string& name, unsigned long ops, Setup setup, Body body)
+{
+	double per_op[BENCH_REPS];
+	unsigned long nodes = 0, allocations = 0;
+	double seconds = 0;
+	for (int rep = -BENCH_WARMUP; rep < BENCH_REPS; ++rep) {
+		setup();
+		unsigned long nodes_in = search_nodes, allocations_in = heap_allocations;
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		for (unsigned long i = 0; i < ops; ++i)
+			body(i);
+		double elapsed = chrono::duration<double>
+			(chrono::steady_clock::now() - begin).count();
+		if (rep < 0)
+			continue;
+		per_op[rep] = elapsed * 1e9 / ops;
+		nodes += search_nodes - nodes_in;
+		allocations += heap_allocations - allocations_in;
+		seconds += elapsed;
+	}
+
+	sort(per_op, per_op + BENCH_REPS);
+	cout << fixed << setprecision(3) << "{\"benchmark\":\"" << name
+		<< "\",\"reps\":" << BENCH_REPS << ",\"ops_per_rep\":" << ops
+		<< ",\"ns_per_op\":" << per_op[BENCH_REPS / 2]
+		<< ",\"min_ns_per_op\":" << per_op[0]
+		<< ",\"nodes_per_s\":" << nodes / seconds
+		<< ",\"allocs_per_op\":" << double(allocations) / (ops * BENCH_REPS)
+		<< ",\"threads\":" << search_pool().size() << "}" << endl;
+}
+
+// bench without a setup
+template <class Body>
+void bench(const string& name, unsigned long ops, Body body)
+{
+	bench(name, ops, [] {}, body);
+}
+
+/* ========== Inputs ========== */
+
+// number of boards the primitives cycle through
+#define BENCH_BOARDS 4096
+
+// returns boards of games played at random up to a random point, the same
+// ones every run, so that inputs aren't constants the compiler could fold
+template <class G>
+vector<BitBoard<G> > bench_boards()
+{
+	Random random(1);
+	vector<BitBoard<G> > boards;
+	while (boards.size() < BENCH_BOARDS) {
+		BitBoard<G> board = clean_board<G>();
+		for (unsigned plies = random.below(G::CELLS + 1); plies > 0 &&
+				board_winner(board) == ' ' && !is_full(board); --plies)
+			place(board, to_move(board), random_cell(empty_mask(board), random));
+		boards.push_back(board);
+	}
+	return boards;
+}
+
+// returns the board of one char per cell, ' ' for empty
+template <class G>
+BitBoard<G> bench_board(const char* cells)
+{
+	Board<G> board;
+	copy(cells, cells + G::CELLS, board.begin());
+	return to_bitboard<G>(board);
+}
+
+// calls per repetition of a position answered without searching a node, by
+// the solved policy or a win on the first move. such an answer takes well
+// under a microsecond, too little to time once, and doesn't read the
+// transposition table, so repeating it measures the same thing every time
+#define BENCH_LOOKUP_OPS 1000
+
+// benchmarks a search of the position from a cleared table: once per
+// repetition if it searches any node, so every search is cold, or else
+// BENCH_LOOKUP_OPS times
+template <class G, class Search>
+void bench_position(const string& name, const BitBoard<G>& board, Search search)
+{
+	tt_clear<G>();
+	unsigned long nodes_in = search_nodes;
+	SearchLimits probe(0, 0, 1);
+	search(board, probe);
+	unsigned long ops = search_nodes == nodes_in ? BENCH_LOOKUP_OPS : 1;
+
+	bench(name, ops, tt_clear<G>, [&](unsigned long) {
+		SearchLimits limits(0, 0, 1);
+		bench_keep(search(board, limits));
+	});
+}
+
+// benchmarks the move of the impossible strategy and a cold exact search from
+// each of the fixed positions
+template <class G>
+void bench_positions(const string& geometry, const char* const positions[4])
+{
+	const char* const names[4] = {"empty", "one-move", "midgame", "near-terminal"};
+	for (unsigned i = 0; i < 4; ++i) {
+		BitBoard<G> board = bench_board<G>(positions[i]);
+		bench_position("minimax/" + geometry + "/" + names[i], board,
+				[](const BitBoard<G>& board, SearchLimits& limits) {
+			return minimax(board, limits);
+		});
+		bench_position("search/" + geometry + "/" + names[i], board,
+				[](const BitBoard<G>& board, SearchLimits& limits) {
+			return minimax_deepening(board, limits);
+		});
+	}
+}
+
+/* ========== Benchmarks ========== */
+
+// runs every benchmark, one JSON line each
+int run_benchmarks()
+{
+	const vector<ClassicBoard> boards = bench_boards<Classic>();
+	const vector<BitBoard<Geometry<7, 7, 5> > > large_boards =
+		bench_boards<Geometry<7, 7, 5> >();
+	const unsigned long ops = 1 << 22;
+	#define BENCH_BOARD(i) boards[(i) % BENCH_BOARDS]
+
+	bench("board_winner/3x3", ops, [&](unsigned long i) {
+		bench_keep(board_winner(BENCH_BOARD(i)));
+	});
+	bench("board_winner/7x7", ops, [&](unsigned long i) {
+		bench_keep(board_winner(large_boards[i % BENCH_BOARDS]));
+	});
+	static char winners[BENCH_BOARDS];
+	bench("board_winners/3x3/4096", ops / BENCH_BOARDS, [&](unsigned long) {
+		board_winners(boards.data(), BENCH_BOARDS, winners);
+		bench_keep(winners);
+	});
+	static BoardBlock<Classic> blocks[BENCH_BOARDS / BATCH_BOARDS];
+	for (size_t i = 0; i < BENCH_BOARDS; ++i) {
+		blocks[i / BATCH_BOARDS].x[i % BATCH_BOARDS] = boards[i].x;
+		blocks[i / BATCH_BOARDS].o[i % BATCH_BOARDS] = boards[i].o;
+	}
+	bench("block_winners/3x3/4096", ops / BENCH_BOARDS, [&](unsigned long) {
+		block_winners(blocks, BENCH_BOARDS / BATCH_BOARDS, winners);
+		bench_keep(winners);
+	});
+	bench("empty_mask/3x3", ops, [&](unsigned long i) {
+		bench_keep(empty_mask(BENCH_BOARD(i)));
+	});
+	bench("is_full/3x3", ops, [&](unsigned long i) {
+		bench_keep(is_full(BENCH_BOARD(i)));
+	});
+	bench("score/3x3", ops, [&](unsigned long i) {
+		bench_keep(score(BENCH_BOARD(i), 'x'));
+	});
+	Random random(1);
+	FixedVector<int, 9> scores;
+	for (int value: {3, -2, 7, 7, 0, 7, -9, 1, 7})
+		scores.push_back(value);
+	bench("rand_max_index/9", ops, [&](unsigned long) {
+		bench_keep(rand_max_index(scores, random));
+	});
+	bench("board_to_string/3x3", ops / 16, [&](unsigned long i) {
+		bench_keep(board_to_string(to_board(BENCH_BOARD(i))));
+	});
+	bench("board_index/3x3", ops, [&](unsigned long i) {
+		bench_keep(board_index(BENCH_BOARD(i)));
+	});
+	bench("board_from_index/3x3", ops, [&](unsigned long i) {
+		bench_keep(board_from_index(i % BOARD_INDEXES));
+	});
+	bench("encode_board/7x7", ops, [&](unsigned long i) {
+		unsigned char bytes[encoded_size<Geometry<7, 7, 5> >()];
+		encode_board(bytes, large_boards[i % BENCH_BOARDS]);
+		bench_keep(bytes);
+	});
+	bench("write_board/3x3", ops, [&](unsigned long i) {
+		char text[9];
+		write_board(text, BENCH_BOARD(i));
+		bench_keep(text);
+	});
+	bench("log_event/off", ops, [&](unsigned long i) {
+		log_event(LOG_MOVE, 'x', i, BENCH_BOARD(i));
+	});
+	// one ring of records per repetition, restarting the log in between, so
+	// that none are dropped, which would cost less than keeping them
+	bench("log_event/on", LOG_RING, [] { event_log.start("/dev/null"); },
+			[&](unsigned long i) {
+		log_event(LOG_MOVE, 'x', i, BENCH_BOARD(i));
+	});
+	event_log.stop();
+#ifndef COMPILE_RAW
+	// frames are gathered and thrown away, never written to the terminal
+	bench("render_board/3x3/full", ops / 64, [&](unsigned long i) {
+		term_frame.at_top = false;
+		render_board<Classic>(to_board(BENCH_BOARD(i)), true, 'x');
+		term_buffer.discard();
+	});
+	bench("render_board/3x3/diff", ops / 64, [&](unsigned long i) {
+		term_frame.at_top = true;
+		render_board<Classic>(to_board(BENCH_BOARD(i)), true, 'x');
+		term_buffer.discard();
+	});
+#endif
+	#undef BENCH_BOARD
+
+	const char* const classic[4] = {
+		"         ",
+		"    x    ",
+		"xo  x   o",
+		"xoxxoo  x"};
+	bench_positions<Classic>("3x3", classic);
+	const char* const four[4] = {
+		"                ",
+		"     x          ",
+		"x o  x    o x  o",
+		"xoxoxoox oxo xox"};
+	bench_positions<Geometry<4, 4, 4> >("4x4", four);
+	return 0;
+}
+
+#endif
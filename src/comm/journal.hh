@@ -0,0 +1,481 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  journal.hh
+ *
+ *    Description:  Game journal: an append-only file of fixed-size records, one per
+ *                  game played, and the statistics of journals scanned in parallel
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:31:16 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_COMM_JOURNAL
+#define TTT_COMM_JOURNAL
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// journals are appended to and mapped with POSIX calls, so only systems that
+// have them keep journals
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TTT_JOURNAL_FILES
+#endif
+
+/* ========== Records ========== */
+
+#define JOURNAL_MAGIC "TTTJRNL\1"
+
+// what a journal starts with: the board its games were played on, and the
+// bytes of each record. records are in the byte order of the machine that
+// wrote them; on any other, the record size doesn't match and the journal is
+// refused
+struct JournalHeader {
+	char magic[8];
+	unsigned char width;
+	unsigned char height;
+	unsigned char length;
+	unsigned char reserved;
+	uint32_t record_size;
+};
+
+// one game. the machine's decision time is kept for each of its moves, and is
+// 0 for the player's moves; it saturates at about 4 seconds
+template <class G>
+struct JournalRecord {
+	uint64_t seed;                   // of the machine's random choices
+	uint64_t started;                // nanoseconds since the epoch
+	unsigned char difficulty;        // 0 => easy, 1 => medium, 2 => impossible
+	char machine;                    // 'x' or 'o'
+	char winner;                     // 'x', 'o', or ' ' for a draw
+	unsigned char plies;             // moves played
+	uint32_t reserved;
+	unsigned char moves[G::CELLS];   // cells in the order played
+	uint32_t latency_ns[G::CELLS];
+};
+
+// returns the header of journals of the board
+template <class G>
+JournalHeader journal_header()
+{
+	JournalHeader header = {};
+	memcpy(header.magic, JOURNAL_MAGIC, sizeof header.magic);
+	header.width = G::WIDTH;
+	header.height = G::HEIGHT;
+	header.length = G::LENGTH;
+	header.record_size = sizeof(JournalRecord<G>);
+	return header;
+}
+
+// returns the record of a game about to begin
+template <class G>
+JournalRecord<G> journal_record(uint64_t seed, short difficulty, char machine)
+{
+	JournalRecord<G> record;
+	memset(&record, 0, sizeof record);
+	record.seed = seed;
+	record.started = chrono::duration_cast<chrono::nanoseconds>(
+			chrono::system_clock::now().time_since_epoch()).count();
+	record.difficulty = difficulty;
+	record.machine = machine;
+	record.winner = ' ';
+	return record;
+}
+
+// adds a move to the record, with the time the machine took to decide it
+template <class G>
+void journal_move(JournalRecord<G>& record, short cell, uint64_t latency_ns)
+{
+	record.moves[record.plies] = cell;
+	record.latency_ns[record.plies] = min(latency_ns, uint64_t(UINT32_MAX));
+	++record.plies;
+}
+
+/* ========== Writing ========== */
+
+// a journal open for appending. each record is appended by one write, which
+// the file system keeps whole and in one piece even when other threads or
+// processes append to the same journal at once. the header is checked, or
+// written to an empty journal, when it is opened, before any game is played
+class GameJournal {
+public:
+	GameJournal() : fd(-1), header()
+	{
+	}
+
+	~GameJournal()
+	{
+#ifdef TTT_JOURNAL_FILES
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+
+	GameJournal(const GameJournal&) = delete;
+	GameJournal& operator=(const GameJournal&) = delete;
+
+	// opens the journal of games of the board at the path, creating it if
+	// missing. returns false, saying why, if it couldn't be opened or holds
+	// games of another board
+	template <class G>
+	bool open(const string& path)
+	{
+#ifdef TTT_JOURNAL_FILES
+		this->path = path;
+		header = journal_header<G>();
+		fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+		if (fd < 0) {
+			cerr << "Cannot open the journal " << path << endl;
+			return false;
+		}
+		// held while the header is written or read, so that of several
+		// processes opening a new journal at once only one writes it, and none
+		// appends before it is there
+		bool checked = flock(fd, LOCK_EX) == 0 && check_header();
+		flock(fd, LOCK_UN);
+		if (checked)
+			return true;
+		cerr << "The journal " << path << " is not a journal of "
+			<< G::WIDTH << "x" << G::HEIGHT << "x" << G::LENGTH
+			<< " games" << endl;
+		close(fd);
+		fd = -1;
+#else
+		cerr << "Journals need a POSIX system" << endl;
+#endif
+		return false;
+	}
+
+	bool active() const
+	{
+		return fd >= 0;
+	}
+
+	// appends the record, which must be of the board the journal was opened
+	// for. returns false, and closes the journal, if it can't be written
+	template <class G>
+	bool append(const JournalRecord<G>& record)
+	{
+#ifdef TTT_JOURNAL_FILES
+		JournalHeader of_record = journal_header<G>();
+		if (fd < 0 || memcmp(&of_record, &header, sizeof header) != 0)
+			return false;
+		if (write(fd, &record, sizeof record) == ssize_t(sizeof record))
+			return true;
+		cerr << "Cannot write to the journal " << path << endl;
+		close(fd);
+		fd = -1;
+#endif
+		return false;
+	}
+
+private:
+#ifdef TTT_JOURNAL_FILES
+	// writes the header to an empty journal, or compares it with the header
+	// already there
+	bool check_header()
+	{
+		struct stat status;
+		if (fstat(fd, &status) != 0)
+			return false;
+		if (status.st_size == 0)
+			return write(fd, &header, sizeof header) == ssize_t(sizeof header);
+		JournalHeader found;
+		return pread(fd, &found, sizeof found, 0) == ssize_t(sizeof found) &&
+			memcmp(&found, &header, sizeof header) == 0;
+	}
+#endif
+
+	int fd;
+	string path;
+	JournalHeader header;
+};
+
+GameJournal game_journal;
+
+/* ========== Statistics ========== */
+
+// records each task of a scan takes
+#define JOURNAL_TASK 65536
+
+// the most two-move openings listed
+#define JOURNAL_OPENINGS 5
+
+// totals over the games of journals, or of part of one. results are from the
+// machine's view, per difficulty
+template <class G>
+struct JournalStats {
+	unsigned long games = 0;
+	unsigned long invalid = 0;
+	unsigned long plies = 0;
+	unsigned long wins[3] = {}, draws[3] = {}, losses[3] = {};
+	unsigned long first_moves[G::CELLS] = {};
+	unsigned long openings[G::CELLS][G::CELLS] = {};
+	LatencyHistogram latency[3];
+
+	// returns whether the record could be of a real game
+	static bool valid(const JournalRecord<G>& record)
+	{
+		if (record.difficulty > 2 || record.plies > G::CELLS ||
+				(record.machine != 'x' && record.machine != 'o') ||
+				(record.winner != 'x' && record.winner != 'o' && record.winner != ' '))
+			return false;
+		for (unsigned ply = 0; ply < record.plies; ++ply) {
+			if (record.moves[ply] >= G::CELLS)
+				return false;
+		}
+		return true;
+	}
+
+	void add(const JournalRecord<G>& record)
+	{
+		if (!valid(record)) {
+			++invalid;
+			return;
+		}
+		++games;
+		plies += record.plies;
+		unsigned difficulty = record.difficulty;
+		if (record.winner == ' ')
+			++draws[difficulty];
+		else if (record.winner == record.machine)
+			++wins[difficulty];
+		else
+			++losses[difficulty];
+		if (record.plies > 0)
+			++first_moves[record.moves[0]];
+		if (record.plies > 1)
+			++openings[record.moves[0]][record.moves[1]];
+
+		// x moves on even plies
+		unsigned machine_ply = record.machine == 'x' ? 0 : 1;
+		for (unsigned ply = machine_ply; ply < record.plies; ply += 2)
+			latency[difficulty].record(record.latency_ns[ply]);
+	}
+
+	void merge(const JournalStats& other)
+	{
+		games += other.games;
+		invalid += other.invalid;
+		plies += other.plies;
+		for (unsigned difficulty = 0; difficulty < 3; ++difficulty) {
+			wins[difficulty] += other.wins[difficulty];
+			draws[difficulty] += other.draws[difficulty];
+			losses[difficulty] += other.losses[difficulty];
+			latency[difficulty].merge(other.latency[difficulty]);
+		}
+		for (unsigned first = 0; first < G::CELLS; ++first) {
+			first_moves[first] += other.first_moves[first];
+			for (unsigned second = 0; second < G::CELLS; ++second)
+				openings[first][second] += other.openings[first][second];
+		}
+	}
+};
+
+// a journal mapped into memory
+struct MappedJournal {
+	string path;
+	const unsigned char* data;
+	size_t size;
+	JournalHeader header;
+	unsigned long records;
+};
+
+// maps the journal at the path and reads its header. returns false if it
+// couldn't be mapped or doesn't start with a header
+bool map_journal(const string& path, MappedJournal& journal)
+{
+#ifdef TTT_JOURNAL_FILES
+	journal.path = path;
+	journal.data = NULL;
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat status;
+	if (fstat(fd, &status) != 0 || size_t(status.st_size) < sizeof(JournalHeader)) {
+		close(fd);
+		return false;
+	}
+	journal.size = status.st_size;
+	void* data = mmap(NULL, journal.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+	// tasks read their parts in order, but all at once
+	madvise(data, journal.size, MADV_WILLNEED);
+	journal.data = static_cast<const unsigned char*>(data);
+	memcpy(&journal.header, journal.data, sizeof journal.header);
+	if (memcmp(journal.header.magic, JOURNAL_MAGIC, sizeof journal.header.magic) != 0 ||
+			journal.header.record_size == 0)
+		return false;
+	// a record cut short by a crash while appending is left out
+	journal.records = (journal.size - sizeof(JournalHeader)) /
+		journal.header.record_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void unmap_journal(MappedJournal& journal)
+{
+#ifdef TTT_JOURNAL_FILES
+	if (journal.data)
+		munmap(const_cast<unsigned char*>(journal.data), journal.size);
+	journal.data = NULL;
+#endif
+}
+
+// scans the journals of the board on the search pool, and prints their
+// statistics
+template <class G>
+void journal_stats(const vector<MappedJournal>& journals)
+{
+	// the parts of the journals tasks take: a journal, and its first record
+	vector<pair<size_t, unsigned long> > parts;
+	for (size_t i = 0; i < journals.size(); ++i) {
+		if (journals[i].header.record_size != sizeof(JournalRecord<G>)) {
+			cerr << "The journal " << journals[i].path
+				<< " has records of another size, and is left out" << endl;
+			continue;
+		}
+		for (unsigned long first = 0; first < journals[i].records;
+				first += JOURNAL_TASK)
+			parts.emplace_back(i, first);
+	}
+
+	JournalStats<G> total;
+	mutex total_lock;
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	auto scan_task = [&](size_t task) {
+		// the histograms and openings take kilobytes, but only one per task
+		unique_ptr<JournalStats<G> > stats(new JournalStats<G>());
+		const MappedJournal& journal = journals[parts[task].first];
+		const JournalRecord<G>* records = reinterpret_cast<const JournalRecord<G>*>(
+				journal.data + sizeof(JournalHeader));
+		unsigned long end = min(journal.records, parts[task].second + JOURNAL_TASK);
+		for (unsigned long i = parts[task].second; i < end; ++i)
+			stats->add(records[i]);
+
+		lock_guard<mutex> guard(total_lock);
+		total.merge(*stats);
+	};
+	search_pool().run(parts.size(), scan_task);
+	double seconds = chrono::duration<double>
+		(chrono::steady_clock::now() - begin).count();
+
+	cout << fixed << setprecision(2) << journals.size() << " journals of "
+		<< G::WIDTH << "x" << G::HEIGHT << "x" << G::LENGTH << " games: "
+		<< total.games << " games, " << (total.games ? double(total.plies) /
+				total.games : 0.0)
+		<< " moves per game, scanned in " << seconds << "s on "
+		<< search_pool().size() << " threads" << endl;
+	if (total.invalid)
+		cout << total.invalid << " invalid records left out" << endl;
+
+	for (unsigned difficulty = 0; difficulty < 3; ++difficulty) {
+		unsigned long games = total.wins[difficulty] + total.draws[difficulty] +
+			total.losses[difficulty];
+		if (!games)
+			continue;
+		const LatencyHistogram& latency = total.latency[difficulty];
+		cout << STRATEGY_NAMES[difficulty] << ": " << games
+			<< " games, machine wins " << total.wins[difficulty] << " ("
+			<< 100.0 * total.wins[difficulty] / games << "%), draws "
+			<< total.draws[difficulty] << " ("
+			<< 100.0 * total.draws[difficulty] / games << "%), machine losses "
+			<< total.losses[difficulty] << " ("
+			<< 100.0 * total.losses[difficulty] / games << "%)" << endl
+			<< STRATEGY_NAMES[difficulty] << " move latency: " << latency.total
+			<< " moves, p50=" << latency.percentile(0.5) << "ns p90="
+			<< latency.percentile(0.9) << "ns p99=" << latency.percentile(0.99)
+			<< "ns p99.9=" << latency.percentile(0.999) << "ns max="
+			<< latency.largest << "ns" << endl;
+	}
+
+	if (!total.games)
+		return;
+	cout << "first moves:";
+	for (unsigned cell = 0; cell < G::CELLS; ++cell) {
+		if (total.first_moves[cell])
+			cout << " " << cell << "=" << 100.0 * total.first_moves[cell] /
+				total.games << "%";
+	}
+	cout << endl << "top openings:";
+	// picks the most played openings one at a time, as there are only a few
+	bool listed[G::CELLS][G::CELLS] = {};
+	for (unsigned rank = 0; rank < JOURNAL_OPENINGS; ++rank) {
+		unsigned best_first = 0, best_second = 0;
+		unsigned long best = 0;
+		for (unsigned first = 0; first < G::CELLS; ++first) {
+			for (unsigned second = 0; second < G::CELLS; ++second) {
+				if (!listed[first][second] && total.openings[first][second] > best) {
+					best = total.openings[first][second];
+					best_first = first;
+					best_second = second;
+				}
+			}
+		}
+		if (!best)
+			break;
+		listed[best_first][best_second] = true;
+		cout << " " << best_first << "," << best_second << "="
+			<< 100.0 * best / total.games << "%";
+	}
+	cout << endl;
+}
+
+// maps the journals at the paths, which must all be of one board, and prints
+// their statistics. returns the exit status
+int journal_report(const vector<string>& paths)
+{
+	vector<MappedJournal> journals(paths.size());
+	int status = 0;
+	for (size_t i = 0; i < paths.size(); ++i) {
+		if (!map_journal(paths[i], journals[i])) {
+			cerr << "Cannot read the journal " << paths[i] << endl;
+			status = 1;
+		} else if (i > 0 && memcmp(&journals[i].header, &journals[0].header,
+					sizeof(JournalHeader)) != 0) {
+			cerr << "The journal " << paths[i] << " is of another board" << endl;
+			status = 1;
+		}
+	}
+
+	if (status == 0) {
+		const JournalHeader& header = journals[0].header;
+		string shape = to_string(header.width) + "x" + to_string(header.height) +
+			"x" + to_string(header.length);
+		if (shape == "3x3x3")
+			journal_stats<Classic>(journals);
+		else if (shape == "4x4x4")
+			journal_stats<Geometry<4, 4, 4> >(journals);
+		else if (shape == "5x5x4")
+			journal_stats<Geometry<5, 5, 4> >(journals);
+		else if (shape == "7x7x5")
+			journal_stats<Geometry<7, 7, 5> >(journals);
+		else {
+			cerr << "Unsupported board " << shape << " in the journals" << endl;
+			status = 1;
+		}
+	}
+	for (MappedJournal& journal: journals)
+		unmap_journal(journal);
+	return status;
+}
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  library.hh
+ *
+ *    Description:  C interface of the engine, for builds as a shared library that
+ *                  other languages load
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:58:42 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_COMM_LIBRARY
+#define TTT_COMM_LIBRARY
+
+#include <atomic>
+#include <cstdint>
+
+// builds with COMPILE_LIBRARY leave out main, and export only the functions
+// below when built as
+//   g++ -std=c++14 -O2 -fPIC -shared -fvisibility=hidden -DCOMPILE_LIBRARY
+//       -o libttt.so ttt-alg.cpp -pthread
+//
+// boards are passed as WIDTH * HEIGHT chars, row by row, 'x' and 'o' for
+// marks and ' ', '.', '-' or '_' for empty cells, without a terminating NUL.
+// the player to move follows from the marks, x moving first. scores are from
+// the view of the player to move: WIN - plies for a win, plies - WIN for a
+// loss and 0 for a draw, where WIN is one more than the cells of the board.
+// every function may be called from any thread; searches that need the
+// search pool take turns on it
+
+// raised whenever a function below changes in a way its callers would notice
+#define TTT_ABI_VERSION 1
+
+// the score of a cell that isn't a move, or of a move that wasn't searched
+#define TTT_NO_SCORE INT32_MIN
+
+#ifdef _WIN32
+#define TTT_EXPORT extern "C" __declspec(dllexport)
+#else
+#define TTT_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+/* ========== Positions ========== */
+
+// reads a board passed by a caller. returns false unless the marks could come
+// from a real game
+template <class G>
+bool library_board(const char* cells, BitBoard<G>& board)
+{
+	return cells && parse_text_board(cells, G::CELLS, board);
+}
+
+// returns whether either player won or the board is full
+template <class G>
+bool library_game_over(const BitBoard<G>& board)
+{
+	return board_winner(board) != ' ' || is_full(board);
+}
+
+// returns the index of the board of the given shape among 3x3x3, 4x4x4, 5x5x4
+// and 7x7x5, or -1 if it is none of them
+int library_shape(int width, int height, int length)
+{
+	const int shapes[][3] = {{3, 3, 3}, {4, 4, 4}, {5, 5, 4}, {7, 7, 5}};
+	for (int shape = 0; shape < 4; ++shape) {
+		if (width == shapes[shape][0] && height == shapes[shape][1] &&
+				length == shapes[shape][2])
+			return shape;
+	}
+	return -1;
+}
+
+/* ========== Engine Calls ========== */
+
+template <class G>
+int library_best_move(const char* cells, int difficulty, int64_t move_time,
+		uint64_t move_nodes, uint64_t seed)
+{
+	BitBoard<G> board;
+	if (!library_board(cells, board) || library_game_over(board))
+		return -1;
+	EngineContext engine(to_move(board), difficulty, move_time, move_nodes, seed);
+	return best_move(engine, board);
+}
+
+template <class G>
+int library_evaluate(const char* cells, int64_t move_time, uint64_t move_nodes,
+		int32_t* scores)
+{
+	BitBoard<G> board;
+	if (!scores || !library_board(cells, board))
+		return -1;
+	fill_n(scores, G::CELLS, TTT_NO_SCORE);
+	if (library_game_over(board))
+		return 0;
+
+	EngineContext engine(to_move(board), 2, move_time, move_nodes, 0);
+	SearchResult result = evaluate(engine, board);
+	int scored = 0;
+	for (uint64_t moves = result.scored_moves; moves; moves &= moves - 1, ++scored)
+		scores[lowest_cell(moves)] = result.scores[lowest_cell(moves)];
+	return scored;
+}
+
+// searches each board on the search pool, a task of ANALYZE_TASK boards at a
+// time, the way analyze_positions does
+template <class G>
+int64_t library_evaluate_batch(const char* cells, size_t count, int64_t move_time,
+		uint64_t move_nodes, uint64_t seed, int32_t* moves, int32_t* scores)
+{
+	if (!cells || !moves || !scores)
+		return -1;
+	atomic<int64_t> invalid(0);
+	auto evaluate_task = [&](size_t task) {
+		size_t end = min(count, (task + 1) * ANALYZE_TASK);
+		for (size_t i = task * ANALYZE_TASK; i < end; ++i) {
+			BitBoard<G> board;
+			moves[i] = -1;
+			scores[i] = TTT_NO_SCORE;
+			if (!library_board(cells + i * G::CELLS, board)) {
+				invalid.fetch_add(1, memory_order_relaxed);
+				continue;
+			}
+			char winner = board_winner(board);
+			if (winner != ' ' || is_full(board)) {
+				// whoever made the last move won it
+				scores[i] = winner == ' ' ? 0 : -int(G::WIN);
+				continue;
+			}
+			SearchLimits limits(move_time, move_nodes, seed + i);
+			limits.parallel = false;
+			moves[i] = minimax(board, limits);
+			scores[i] = limits.result.score;
+		}
+	};
+	search_pool().run((count + ANALYZE_TASK - 1) / ANALYZE_TASK, evaluate_task);
+	return invalid;
+}
+
+/* ========== Exported Functions ========== */
+
+// no exception may reach a caller in another language, so each function
+// answers as it would for bad arguments instead
+
+// returns TTT_ABI_VERSION, for callers to check before calling anything else
+TTT_EXPORT int ttt_abi_version()
+{
+	return TTT_ABI_VERSION;
+}
+
+// returns the move of the strategy of the difficulty (0 => easy, 1 => medium,
+// 2 => impossible) for the player to move, searching at most move_time
+// milliseconds and move_nodes nodes (0 for no limit), with its random choices
+// seeded by seed. returns -1 for a bad shape, board or difficulty, or when
+// the game is over
+TTT_EXPORT int ttt_best_move(const char* board, int width, int height, int length,
+		int difficulty, int64_t move_time, uint64_t move_nodes, uint64_t seed)
+{
+	try {
+		switch (library_shape(width, height, length)) {
+		case 0:
+			return library_best_move<Classic>(board, difficulty, move_time,
+					move_nodes, seed);
+		case 1:
+			return library_best_move<Geometry<4, 4, 4> >(board, difficulty,
+					move_time, move_nodes, seed);
+		case 2:
+			return library_best_move<Geometry<5, 5, 4> >(board, difficulty,
+					move_time, move_nodes, seed);
+		case 3:
+			return library_best_move<Geometry<7, 7, 5> >(board, difficulty,
+					move_time, move_nodes, seed);
+		}
+	} catch (...) {
+	}
+	return -1;
+}
+
+// writes the score of every cell of the board to scores, which holds one per
+// cell: TTT_NO_SCORE for cells that aren't moves. as in SearchResult, a move
+// that can't beat the best holds an upper bound of its score. returns the
+// moves scored, 0 when the game is over, or -1 for a bad shape or board
+TTT_EXPORT int ttt_evaluate(const char* board, int width, int height, int length,
+		int64_t move_time, uint64_t move_nodes, int32_t* scores)
+{
+	try {
+		switch (library_shape(width, height, length)) {
+		case 0:
+			return library_evaluate<Classic>(board, move_time, move_nodes, scores);
+		case 1:
+			return library_evaluate<Geometry<4, 4, 4> >(board, move_time,
+					move_nodes, scores);
+		case 2:
+			return library_evaluate<Geometry<5, 5, 4> >(board, move_time,
+					move_nodes, scores);
+		case 3:
+			return library_evaluate<Geometry<7, 7, 5> >(board, move_time,
+					move_nodes, scores);
+		}
+	} catch (...) {
+	}
+	return -1;
+}
+
+// searches count boards laid end to end, in parallel, and writes the best move
+// of each to moves and its score to scores. board i is searched with the seed
+// seed + i, so a batch bounded by nodes rather than time gives the same
+// answers however many threads search it. a finished game gets the move -1
+// and its final score; an invalid board gets -1 and TTT_NO_SCORE. returns the
+// number of invalid boards, or -1 for a bad shape or null arguments
+TTT_EXPORT int64_t ttt_evaluate_batch(const char* boards, uint64_t count, int width,
+		int height, int length, int64_t move_time, uint64_t move_nodes,
+		uint64_t seed, int32_t* moves, int32_t* scores)
+{
+	try {
+		switch (library_shape(width, height, length)) {
+		case 0:
+			return library_evaluate_batch<Classic>(boards, count, move_time,
+					move_nodes, seed, moves, scores);
+		case 1:
+			return library_evaluate_batch<Geometry<4, 4, 4> >(boards, count,
+					move_time, move_nodes, seed, moves, scores);
+		case 2:
+			return library_evaluate_batch<Geometry<5, 5, 4> >(boards, count,
+					move_time, move_nodes, seed, moves, scores);
+		case 3:
+			return library_evaluate_batch<Geometry<7, 7, 5> >(boards, count,
+					move_time, move_nodes, seed, moves, scores);
+		}
+	} catch (...) {
+	}
+	return -1;
+}
+
+#endif
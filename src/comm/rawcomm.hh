@@ -18,22 +18,28 @@
 
 short proto_out(short prot)
 {
+	MetricTimer timer(proto_out_latency);
 	cout << "ProtoOut => " << prot << endl;
 	return 0;
 }
 
 short proto_query(short query)
 {
+	MetricTimer timer(proto_query_latency);
 	cout << "Query " << query << ">";
 	short input;
 	cin >> input;
 	return input;
 }
 
-short board_out(const Board& brd)
+template <class G>
+short board_out(const Board<G>& brd, char)
 {
-	cout << brd[0] << brd[1] << brd[2] << endl
-		<< brd[3] << brd[4] << brd[5] << endl
-		<< brd[6] << brd[7] << brd[8] << endl;
+	MetricTimer timer(render_latency);
+	for (size_t i = 0; i < G::CELLS; ++i) {
+		cout << brd[i];
+		if (i % G::WIDTH == G::WIDTH - 1)
+			cout << endl;
+	}
 	return 0;
 }
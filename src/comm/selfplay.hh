@@ -0,0 +1,126 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  selfplay.hh
+ *
+ *    Description:  Headless self-play between two strategies, for strength and load tests
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 06:24:15 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_COMM_SELFPLAY
+#define TTT_COMM_SELFPLAY
+
+#include <mutex>
+
+/* ========== Self Play ========== */
+
+// games per pool task
+#define SELFPLAY_TASK 256
+
+// results of a run of games, from the view of the first strategy, and the
+// time each strategy took per move
+struct SelfPlayTally {
+	unsigned long wins = 0, draws = 0, losses = 0;
+	LatencyHistogram latency[2];
+};
+
+// plays one game between the strategies of the given difficulties, and adds
+// it to the tally
+template <class G>
+void selfplay_game(const short strategies[2], bool first_is_x,
+		const GameSettings& settings, uint64_t seed, SelfPlayTally& tally)
+{
+	char first = first_is_x ? 'x' : 'o';
+	Random game_random(seed);
+	// the players search one after the other on this pool thread
+	EngineContext players[2] = {
+		EngineContext(first, strategies[0], settings.move_time,
+				settings.move_nodes, game_random()),
+		EngineContext(inverse(first), strategies[1], settings.move_time,
+				settings.move_nodes, game_random()),
+	};
+	players[0].parallel = players[1].parallel = false;
+	BitBoard<G> board = clean_board<G>();
+	while (board_winner(board) == ' ' && !is_full(board)) {
+		unsigned side = to_move(board) == first ? 0 : 1;
+		short move = best_move(players[side], board);
+		tally.latency[side].record(players[side].last.elapsed_ns);
+		place(board, players[side].machine, move);
+	}
+
+	++games_played;
+	char winner = board_winner(board);
+	if (winner == ' ')
+		++tally.draws;
+	else if (winner == first)
+		++tally.wins;
+	else
+		++tally.losses;
+}
+
+// plays the given number of games between the strategies of the given
+// difficulties on the search pool, the first strategy playing x in every
+// other game, and prints the results. game i is seeded with the seed of the
+// settings plus i, so strategies that don't search replay the same games on
+// any number of threads. searches also depend on what the shared transposition
+// table holds, so they only replay exactly on one thread bounded by nodes
+template <class G>
+void selfplay(unsigned long games, const short strategies[2],
+		const GameSettings& settings)
+{
+	SelfPlayTally total;
+	mutex total_lock;
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	auto play_task = [&](size_t task) {
+		// several kilobytes of histograms, but only one per task
+		SelfPlayTally tally;
+		unsigned long end = min<unsigned long>(games, (task + 1) * SELFPLAY_TASK);
+		for (unsigned long game = task * SELFPLAY_TASK; game < end; ++game)
+			selfplay_game<G>(strategies, game % 2 == 0, settings,
+					settings.seed + game, tally);
+
+		lock_guard<mutex> guard(total_lock);
+		total.wins += tally.wins;
+		total.draws += tally.draws;
+		total.losses += tally.losses;
+		total.latency[0].merge(tally.latency[0]);
+		total.latency[1].merge(tally.latency[1]);
+	};
+	search_pool().run((games + SELFPLAY_TASK - 1) / SELFPLAY_TASK, play_task);
+	double seconds = chrono::duration<double>
+		(chrono::steady_clock::now() - begin).count();
+
+	// strategies may play themselves, so they are told apart by who started
+	string names[2];
+	for (unsigned side = 0; side < 2; ++side)
+		names[side] = string(side == 0 ? "first" : "second") + " (" +
+			STRATEGY_NAMES[strategies[side]] + ")";
+	cout << fixed << setprecision(2)
+		<< STRATEGY_NAMES[strategies[0]] << " vs " << STRATEGY_NAMES[strategies[1]]
+		<< ": " << games << " games in " << seconds << "s on "
+		<< search_pool().size() << " threads, " << games / seconds << " games/s"
+		<< endl
+		<< names[0] << ": " << total.wins << " wins ("
+		<< 100.0 * total.wins / games << "%), " << total.draws << " draws ("
+		<< 100.0 * total.draws / games << "%), " << total.losses << " losses ("
+		<< 100.0 * total.losses / games << "%)" << endl;
+	for (unsigned side = 0; side < 2; ++side) {
+		const LatencyHistogram& latency = total.latency[side];
+		cout << names[side] << " move latency: " << latency.total
+			<< " moves, p50=" << latency.percentile(0.5) << "ns p90="
+			<< latency.percentile(0.9) << "ns p99=" << latency.percentile(0.99)
+			<< "ns p99.9=" << latency.percentile(0.999) << "ns max="
+			<< latency.largest << "ns" << endl;
+	}
+}
+
+#endif
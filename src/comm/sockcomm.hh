@@ -3,9 +3,11 @@
  *
  *       Filename:  sockcomm.hh
  *
- *    Description:  Socket communication for Tic-Tac-Toe
+ *    Description:  Socket communication for Tic-Tac-Toe: an asynchronous TCP server
+ *                  hosting one game per connection, or many games per connection
+ *                  over the framed protocol
  *
- *        Version:  0.1
+ *        Version:  1.0
  *        Created:  11/14/2016 09:46:09 AM
  *       Revision:  none
  *       Compiler:  gcc
@@ -20,6 +22,11 @@
 
 #define TTT_SOCKCOMM
 #include <boost/asio.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 
 using boost::asio::ip::tcp;
 
@@ -35,40 +42,607 @@ char encrypt_char(short send)
 	return static_cast<char>(send + 3);
 }
 
-boost::asio::io_service sock_io;
-tcp::acceptor sock_accept(sock_io, tcp::endpoint(tcp::v4(), 52443));
-tcp::socket sock;
+/* Socket protocol
+ *
+ * Every message is one byte, the code encrypted by encrypt_char, the same
+ * codes as the terminal protocol. Per connection:
+ *
+ *   server: 0 (who first)        client: +/-1..3 as in the terminal protocol
+ *   then until the game is over, on the machine's turn:
+ *   server: 2 (thinking), the machine's cell, 4 (fine choice)
+ *   and on the client's turn:
+ *   server: 1 (what cell)        client: a cell
+ *   server: 4, or 3 (bad choice) followed by 1 again
+ *   then:
+ *   server: 5 (game done), 20/21/22 (machine wins/client wins/tie),
+ *           30 (again)           client: 1 for another game from who first, 0
+ *                                to be disconnected
+ *
+ * An answer out of range gets 3 (bad choice) and the question again.
+ */
 
-void proto_init()
-{
-	try {
-		cout << "Waiting for acceptance on TCP port 52443" << endl;
-		sock_accept.accept(sock);
-		cout << "Client accepted" << endl;
-	} catch (exception& e) {
-		cerr << e.what() << endl;
+/* ========== Sessions ========== */
+
+Gauge sessions_active("ttt_sessions_active", "Connections being served");
+Counter sessions_served("ttt_sessions_total", "Connections accepted");
+
+// the most bytes the server sends before it waits for an answer: the
+// machine's move and the end of the game with the question that follows
+#define SESSION_OUTPUT 16
+
+// one connection and the game played over it. the session only ever has one
+// read, one write or one search in flight, so its handlers never run at once,
+// and it needs no lock. the machine's moves are searched on the search threads
+// rather than the event loop, which goes on serving the other connections. it
+// keeps itself alive through the handlers it passes to asio
+template <class G>
+class GameSession : public enable_shared_from_this<GameSession<G> > {
+public:
+	GameSession(tcp::socket socket, const GameSettings& settings, uint64_t seed,
+			boost::asio::thread_pool& searches) :
+		socket(move(socket)), searches(searches), engine('x', settings.difficulty,
+				settings.move_time, settings.move_nodes, seed),
+		board(clean_board<G>()), output_size(0), awaiting(AWAIT_WHOFIRST)
+	{
+		// the other sessions keep the rest of the threads busy
+		engine.parallel = false;
+		sessions_active.add(1);
+		++sessions_served;
 	}
-}
 
-short proto_out(short proto)
-{
-	try {
-		boost::asio::write(sock,
-				boost::asio::buffer(encrypt_char(proto)));
-	} catch (exception& e) {
-		cerr << e.what() << endl;
+	~GameSession()
+	{
+		if (awaiting != AWAIT_WHOFIRST && awaiting != AWAIT_AGAIN)
+			games_active.add(-1);
+		sessions_active.add(-1);
+	}
+
+	void start()
+	{
+		boost::system::error_code ignored;
+		socket.set_option(tcp::no_delay(true), ignored);
+		ask(PROTO_WHOFIRST, AWAIT_WHOFIRST);
+	}
+
+private:
+	// what the answer the session waits for answers
+	enum Awaiting {
+		AWAIT_WHOFIRST,
+		AWAIT_CELL,
+		AWAIT_AGAIN,
+	};
+
+	void send(short code)
+	{
+		output[output_size++] = encrypt_char(code);
+	}
+
+	// sends everything queued with the question, then waits for its answer
+	void ask(short question, Awaiting answer)
+	{
+		send(question);
+		awaiting = answer;
+		auto self = this->shared_from_this();
+		boost::asio::async_write(socket, boost::asio::buffer(output, output_size),
+				[this, self](const boost::system::error_code& error, size_t) {
+			if (error)
+				return;
+			output_size = 0;
+			asked_at = chrono::steady_clock::now();
+			boost::asio::async_read(socket, boost::asio::buffer(&input, 1),
+					[this, self](const boost::system::error_code& error, size_t) {
+				if (error)
+					return;
+				proto_query_latency.record(chrono::duration_cast<chrono::nanoseconds>
+						(chrono::steady_clock::now() - asked_at).count());
+				answered(decrypt_char(input));
+			});
+		});
+	}
+
+	// sends what is queued and lets the connection go
+	void finish()
+	{
+		auto self = this->shared_from_this();
+		boost::asio::async_write(socket, boost::asio::buffer(output, output_size),
+				[this, self](const boost::system::error_code&, size_t) {
+			boost::system::error_code ignored;
+			socket.shutdown(tcp::socket::shutdown_both, ignored);
+		});
+	}
+
+	void answered(short answer)
+	{
+		switch (awaiting) {
+		case AWAIT_WHOFIRST:
+			if (answer == 0 || answer < -3 || answer > 3) {
+				send(PROTO_BADCHOICE);
+				ask(PROTO_WHOFIRST, AWAIT_WHOFIRST);
+				return;
+			}
+			engine.machine = parse_whofirst_response(answer).first ? 'x' : 'o';
+			engine.difficulty = parse_whofirst_response(answer).second;
+			board = clean_board<G>();
+			games_active.add(1);
+			play();
+			return;
+
+		case AWAIT_CELL:
+			// we don't trust the player
+			if (answer < 0 || answer >= short(G::CELLS) ||
+					!(empty_mask(board) & (typename G::Mask(1) << answer))) {
+				send(PROTO_BADCHOICE);
+				ask(PROTO_WHATCELL, AWAIT_CELL);
+				return;
+			}
+			place(board, inverse(engine.machine), answer);
+			send(PROTO_FINECHOICE);
+			play();
+			return;
+
+		case AWAIT_AGAIN:
+			if (answer == 1) {
+				ask(PROTO_WHOFIRST, AWAIT_WHOFIRST);
+			} else if (answer == 0) {
+				finish();
+			} else {
+				send(PROTO_BADCHOICE);
+				ask(PROTO_AGAIN, AWAIT_AGAIN);
+			}
+			return;
+		}
+	}
+
+	// searches the machine's move on the search threads if it is its turn,
+	// and plays it back on the session's strand
+	void play()
+	{
+		if (board_winner(board) != ' ' || is_full(board) ||
+				to_move(board) != engine.machine) {
+			respond();
+			return;
+		}
+		auto self = this->shared_from_this();
+		boost::asio::post(searches, [this, self] {
+			short move = best_move(engine, board);
+			boost::asio::post(socket.get_executor(), [this, self, move] {
+				moved(move);
+			});
+		});
+	}
+
+	void moved(short move)
+	{
+		if (move >= 0) {
+			send(PROTO_IMTHINKING);
+			place(board, engine.machine, move);
+			send(move);
+			send(PROTO_FINECHOICE);
+		}
+		respond();
 	}
+
+	// asks for the client's move, or ends the game once it is over
+	void respond()
+	{
+		char winner = board_winner(board);
+		if (winner == ' ' && !is_full(board)) {
+			ask(PROTO_WHATCELL, AWAIT_CELL);
+			return;
+		}
+		games_active.add(-1);
+		++games_played;
+		send(PROTO_GAMEDONE);
+		send(winner == engine.machine ? PROTO_IWIN : winner == ' ' ? PROTO_TIE : PROTO_UWIN);
+		ask(PROTO_AGAIN, AWAIT_AGAIN);
+	}
+
+	tcp::socket socket;
+	boost::asio::thread_pool& searches;
+	EngineContext engine;
+	BitBoard<G> board;
+
+	char output[SESSION_OUTPUT];
+	size_t output_size;
+	char input;
+	Awaiting awaiting;
+	chrono::steady_clock::time_point asked_at;
+};
+
+/* ========== Framed Sessions ========== */
+
+/* Framed protocol (--protocol framed)
+ *
+ * Many games share one connection. Every message is a frame: a header of four
+ * bytes, the length of the payload, the type, and the game as two bytes
+ * little-endian, then the payload. The client numbers its games, and may reuse
+ * a number once its game is over.
+ *
+ *   client frames:
+ *   FRAME_NEW (1)     payload: the who-first answer of the terminal protocol,
+ *                     +/-1..3, as a signed byte. starts the game
+ *   FRAME_MOVE (2)    payload: the client's cell
+ *   FRAME_END (3)     no payload. abandons the game, and isn't answered
+ *
+ *   server frames:
+ *   FRAME_MOVE (2)    payload: the machine's cell
+ *   FRAME_BOARD (4)   payload: the board as encode_board writes it: the
+ *                     base-3 index in 2 bytes on 3x3 boards, or else the x
+ *                     mask then the o mask, little-endian
+ *   FRAME_RESULT (5)  payload: 20/21/22 (machine wins/client wins/tie). the
+ *                     game is over
+ *   FRAME_ERROR (6)   payload: the type of the refused frame, then why:
+ *                     1 no such game, 2 the game exists, 3 bad choice,
+ *                     4 bad frame
+ *
+ * Every FRAME_NEW and FRAME_MOVE is answered in the order it came, either with
+ * FRAME_ERROR, or with the machine's FRAME_MOVE if it moved, FRAME_BOARD and
+ * FRAME_RESULT if the game is over. Clients may send any number of frames
+ * without waiting for answers; the server answers all it has read in as few
+ * writes as it can.
+ */
+
+// the bytes of a frame header
+#define FRAME_HEADER 4
+
+// frame types
+#define FRAME_NEW 1
+#define FRAME_MOVE 2
+#define FRAME_END 3
+#define FRAME_BOARD 4
+#define FRAME_RESULT 5
+#define FRAME_ERROR 6
+
+// why a frame is refused
+#define FRAME_NO_GAME 1
+#define FRAME_GAME_EXISTS 2
+#define FRAME_BAD_CHOICE 3
+#define FRAME_BAD_FRAME 4
+
+// bytes read at once, which any frame fits in, and bytes of an output block
+#define FRAMED_INPUT 16384
+#define FRAMED_BLOCK 4096
+
+// the most blocks sent by one write, and the most blocks waiting to be sent
+// before the session stops reading. a client that doesn't read its answers
+// can't make the server hold more than that
+#define FRAMED_GATHER 64
+#define FRAMED_BACKLOG 64
+
+Counter frames_received("ttt_frames_received_total",
+		"Frames read from framed connections");
+Counter frames_sent("ttt_frames_sent_total", "Frames sent on framed connections");
+Counter frame_writes("ttt_frame_writes_total",
+		"Writes that sent frames on framed connections");
+
+// frames waiting to be sent, back to back
+struct FrameBlock {
+	size_t size;
+	unsigned char data[FRAMED_BLOCK];
+};
+
+// one connection and the games played over it. frames are answered into
+// blocks, and every block waiting is sent by one gathered write once nothing
+// else is being written, so answers to frames read together go out together.
+// a read and a write may be in flight at once; the socket runs its handlers
+// on a strand, so they still never run at once. a machine move is searched on
+// the search threads while the session reads and answers nothing more, so
+// answers keep the order of the frames; only blocks already answered are
+// written meanwhile, which leaves the games and the engine to the search
+template <class G>
+class FramedSession : public enable_shared_from_this<FramedSession<G> > {
+public:
+	FramedSession(tcp::socket socket, const GameSettings& settings, uint64_t seed,
+			boost::asio::thread_pool& searches) :
+		socket(move(socket)), searches(searches), engine('x', settings.difficulty,
+				settings.move_time, settings.move_nodes, seed),
+		input_size(0), writing(0), reading(false), searching(false)
+	{
+		// the other sessions keep the rest of the threads busy
+		engine.parallel = false;
+		gather.reserve(FRAMED_GATHER);
+		sessions_active.add(1);
+		++sessions_served;
+	}
+
+	~FramedSession()
+	{
+		games_active.add(-long(games.size()));
+		sessions_active.add(-1);
+	}
+
+	void start()
+	{
+		boost::system::error_code ignored;
+		socket.set_option(tcp::no_delay(true), ignored);
+		receive();
+	}
+
+private:
+	typedef typename G::Mask Mask;
+
+	// a game of the connection, always waiting for the client's move
+	struct Game {
+		BitBoard<G> board;
+		char machine;
+		short difficulty;
+	};
+
+	// reads more frames and answers them, unless too many blocks wait to be
+	// sent, in which case send() reads once they are
+	void receive()
+	{
+		reading = blocks.size() < FRAMED_BACKLOG;
+		if (!reading)
+			return;
+		auto self = this->shared_from_this();
+		socket.async_read_some(boost::asio::buffer(input + input_size,
+					FRAMED_INPUT - input_size),
+				[this, self](const boost::system::error_code& error, size_t count) {
+			if (error)
+				return;
+			input_size += count;
+			process();
+		});
+	}
+
+	// answers every whole frame read until one waits for a search, sends the
+	// answers, and reads more unless a search is under way
+	void process()
+	{
+		size_t used = 0;
+		while (!searching && input_size - used >= FRAME_HEADER &&
+				input_size - used >= FRAME_HEADER + size_t(input[used])) {
+			const unsigned char* header = input + used;
+			answer(header[1], header[2] | header[3] << 8,
+					header + FRAME_HEADER, header[0]);
+			used += FRAME_HEADER + header[0];
+		}
+		memmove(input, input + used, input_size - used);
+		input_size -= used;
+		send();
+		if (!searching)
+			receive();
+	}
+
+	// sends the blocks waiting, if nothing is being written
+	void send()
+	{
+		if (writing || blocks.empty())
+			return;
+		writing = min(blocks.size(), size_t(FRAMED_GATHER));
+		gather.clear();
+		for (size_t i = 0; i < writing; ++i)
+			gather.push_back(boost::asio::buffer(blocks[i]->data, blocks[i]->size));
+		++frame_writes;
+		auto self = this->shared_from_this();
+		boost::asio::async_write(socket, gather,
+				[this, self](const boost::system::error_code& error, size_t) {
+			if (error)
+				return;
+			for (; writing > 0; --writing) {
+				spare.push_back(move(blocks.front()));
+				blocks.pop_front();
+			}
+			send();
+			if (!reading && !searching)
+				receive();
+		});
+	}
+
+	// adds a frame to the blocks waiting, and returns where its payload goes
+	unsigned char* frame(unsigned char type, unsigned short game,
+			unsigned char length)
+	{
+		if (blocks.size() == writing ||
+				blocks.back()->size + FRAME_HEADER + length > FRAMED_BLOCK) {
+			if (spare.empty()) {
+				blocks.emplace_back(new FrameBlock);
+			} else {
+				blocks.push_back(move(spare.back()));
+				spare.pop_back();
+			}
+			blocks.back()->size = 0;
+		}
+		FrameBlock& block = *blocks.back();
+		unsigned char* out = block.data + block.size;
+		out[0] = length;
+		out[1] = type;
+		out[2] = game & 0xff;
+		out[3] = game >> 8;
+		block.size += FRAME_HEADER + length;
+		++frames_sent;
+		return out + FRAME_HEADER;
+	}
+
+	void refuse(unsigned char type, unsigned short game, unsigned char reason)
+	{
+		unsigned char* out = frame(FRAME_ERROR, game, 2);
+		out[0] = type;
+		out[1] = reason;
+	}
+
+	// answers a frame from the client
+	void answer(unsigned char type, unsigned short id,
+			const unsigned char* payload, unsigned char length)
+	{
+		++frames_received;
+		auto found = games.find(id);
+		if (type == FRAME_END) {
+			if (found != games.end()) {
+				games.erase(found);
+				games_active.add(-1);
+			}
+			return;
+		}
+		if ((type != FRAME_NEW && type != FRAME_MOVE) || length != 1) {
+			refuse(type, id, FRAME_BAD_FRAME);
+			return;
+		}
+
+		if (type == FRAME_NEW) {
+			short answer = static_cast<signed char>(payload[0]);
+			if (found != games.end()) {
+				refuse(type, id, FRAME_GAME_EXISTS);
+				return;
+			}
+			if (answer == 0 || answer < -3 || answer > 3) {
+				refuse(type, id, FRAME_BAD_CHOICE);
+				return;
+			}
+			Game& game = games[id];
+			game.board = clean_board<G>();
+			game.machine = parse_whofirst_response(answer).first ? 'x' : 'o';
+			game.difficulty = parse_whofirst_response(answer).second;
+			games_active.add(1);
+			play(id, game);
+			return;
+		}
+
+		if (found == games.end()) {
+			refuse(type, id, FRAME_NO_GAME);
+			return;
+		}
+		// we don't trust the player
+		Game& game = found->second;
+		short cell = payload[0];
+		if (cell >= short(G::CELLS) ||
+				!(empty_mask(game.board) & (Mask(1) << cell))) {
+			refuse(type, id, FRAME_BAD_CHOICE);
+			return;
+		}
+		place(game.board, inverse(game.machine), cell);
+		play(id, game);
+	}
+
+	// searches the machine's move on the search threads if it is its turn,
+	// and plays it back on the session's strand. otherwise answers at once
+	void play(unsigned short id, Game& game)
+	{
+		if (board_winner(game.board) != ' ' || is_full(game.board) ||
+				to_move(game.board) != game.machine) {
+			respond(id, game);
+			return;
+		}
+		engine.machine = game.machine;
+		engine.difficulty = game.difficulty;
+		searching = true;
+		auto self = this->shared_from_this();
+		boost::asio::post(searches, [this, self, id, board = game.board] {
+			short move = best_move(engine, board);
+			boost::asio::post(socket.get_executor(), [this, self, id, move] {
+				moved(id, move);
+			});
+		});
+	}
+
+	// plays the machine's move, answers, and goes on with the frames read
+	void moved(unsigned short id, short move)
+	{
+		searching = false;
+		// no frame was answered during the search, so the game is still there
+		Game& game = games.find(id)->second;
+		if (move >= 0) {
+			place(game.board, game.machine, move);
+			*frame(FRAME_MOVE, id, 1) = move;
+		}
+		respond(id, game);
+		process();
+	}
+
+	// answers with the board, and with the result if the game is over
+	void respond(unsigned short id, Game& game)
+	{
+		encode_board(frame(FRAME_BOARD, id, encoded_size<G>()), game.board);
+
+		char winner = board_winner(game.board);
+		if (winner == ' ' && !is_full(game.board))
+			return;
+		*frame(FRAME_RESULT, id, 1) = winner == game.machine ? PROTO_IWIN :
+			winner == ' ' ? PROTO_TIE : PROTO_UWIN;
+		games_active.add(-1);
+		++games_played;
+		games.erase(id);
+	}
+
+	tcp::socket socket;
+	boost::asio::thread_pool& searches;
+	EngineContext engine;
+	unordered_map<unsigned short, Game> games;
+
+	unsigned char input[FRAMED_INPUT];
+	size_t input_size;
+
+	// blocks waiting, the first writing of which are being written, and
+	// blocks sent already, kept to be filled again
+	deque<unique_ptr<FrameBlock> > blocks;
+	vector<unique_ptr<FrameBlock> > spare;
+	vector<boost::asio::const_buffer> gather;
+	size_t writing;
+	bool reading;
+	bool searching;
+};
+
+/* ========== Server ========== */
+
+// accepts connections for good, starting a session on each. every socket
+// runs its handlers on a strand of its own. when accepting fails, e.g. for
+// lack of file descriptors, it tries again a little later
+template <class Session>
+void accept_sessions(tcp::acceptor& acceptor, boost::asio::steady_timer& retry,
+		const GameSettings& settings, uint64_t& seed,
+		boost::asio::thread_pool& searches)
+{
+	acceptor.async_accept(boost::asio::make_strand(acceptor.get_executor()),
+			[&](const boost::system::error_code& error, tcp::socket socket) {
+		if (error == boost::asio::error::operation_aborted)
+			return;
+		if (error) {
+			cerr << "Cannot accept: " << error.message() << endl;
+			retry.expires_after(chrono::milliseconds(100));
+			retry.async_wait([&](const boost::system::error_code& error) {
+				if (!error)
+					accept_sessions<Session>(acceptor, retry, settings, seed, searches);
+			});
+			return;
+		}
+		make_shared<Session>(move(socket), settings, seed++, searches)->start();
+		accept_sessions<Session>(acceptor, retry, settings, seed, searches);
+	});
 }
 
-short proto_query(short proto_out)
+// serves games on the board on the TCP port until interrupted, each
+// connection a session of its own, over the framed protocol if asked to, or
+// else the protocol of one byte per message. session i is seeded with the seed of
+// the settings plus i. the event loop runs on the calling thread, and only
+// reads, writes and answers; machine moves are searched on as many threads of
+// their own as the search pool would have, so a long search holds up no other
+// connection
+template <class G>
+void serve_games(unsigned short port, const GameSettings& settings, bool framed)
 {
-	try {
-		boost::asio::write(sock,
-				boost::asio::buffer(encrypt_char(proto_out)));
-		char data[1];
-		boost::system::error_code errcode;
-		// TODO
-	}
+	boost::asio::io_context io;
+	// declared after io, so it is stopped first, and searches never post back
+	// to a destroyed event loop
+	boost::asio::thread_pool searches(search_thread_count());
+	tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), port));
+	acceptor.listen(boost::asio::socket_base::max_listen_connections);
+	boost::asio::steady_timer retry(io);
+	uint64_t seed = settings.seed;
+	if (framed)
+		accept_sessions<FramedSession<G> >(acceptor, retry, settings, seed, searches);
+	else
+		accept_sessions<GameSession<G> >(acceptor, retry, settings, seed, searches);
+
+	boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+	signals.async_wait([&](const boost::system::error_code&, int) {
+		io.stop();
+	});
+
+	cout << "Serving games on TCP port " << port << endl;
+	io.run();
+	searches.stop();
+	searches.join();
 }
 
 #endif
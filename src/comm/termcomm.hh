@@ -20,175 +20,322 @@
 
 #define TTT_TERMCOMM
 
+#include <cerrno>
+
+/* ========== Terminal Output ========== */
+
+// bytes of terminal output gathered before it is written: a whole frame of the
+// largest board with every cell painted fits
+#define TERM_OUTPUT 8192
+
+// a fixed buffer that terminal output is gathered in, so that a frame or a
+// message reaches the terminal in one system call when it is flushed. if it
+// fills up, it writes out what it holds and goes on
+class TermBuffer : public streambuf {
+public:
+	TermBuffer()
+	{
+		setp(data, data + TERM_OUTPUT);
+	}
+
+	// throws away what is gathered
+	void discard()
+	{
+		setp(data, data + TERM_OUTPUT);
+	}
+
+protected:
+	// writes out what is gathered, after whatever went to cout before it
+	int sync()
+	{
+		cout.flush();
+		const char* from = pbase();
+		size_t left = pptr() - pbase();
+#if defined(__linux__) || defined(__APPLE__)
+		while (left > 0) {
+			ssize_t written = ::write(STDOUT_FILENO, from, left);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written < 0)
+				break;
+			from += written;
+			left -= written;
+		}
+#else
+		fwrite(from, 1, left, stdout);
+		fflush(stdout);
+#endif
+		discard();
+		return 0;
+	}
+
+	int overflow(int c)
+	{
+		sync();
+		if (c != traits_type::eof()) {
+			*pptr() = c;
+			pbump(1);
+		}
+		return c;
+	}
+
+private:
+	char data[TERM_OUTPUT];
+};
+
+TermBuffer term_buffer;
+ostream term_out(&term_buffer);
+
+// the last frame drawn: its cells and how they were painted, and whether the
+// cursor is back at its top left corner, where a frame of the same shape can
+// be drawn over it by redrawing the cells that changed
+struct TermFrame {
+	char cells[64];
+	unsigned short width = 0;
+	unsigned short height = 0;
+	bool with_color = false;
+	char machine = ' ';
+	bool at_top = false;
+};
+
+TermFrame term_frame;
+
+// shape of the last printed board, so prompts and cursor moves can follow it
+unsigned short term_board_rows = 3;
+unsigned short term_board_cells = 9;
+
+/* ========== Protocol ========== */
+
 short get_short_range(const string& prompt, short low, short high)
 {
 	short input;
-	cout << prompt;
+	term_out << prompt << flush;
 	while (true) {
 		cin >> input;
-		debug_file << "get_short_range: input = " << input << endl;
+		log_event(LOG_INPUT, 0, input);
 		if (input > low && input < high) {
 			break;
 		} else {
-			cout << "\e[1A\e[2KOut of range! " << prompt;
+			term_out << "\e[1A\e[2KOut of range! " << prompt << flush;
 		}
 	}
-	debug_file << "get_short_range: about to return" << endl;
+	log_event(LOG_INPUT_DONE, 0, input);
 	return input;
 }
 
+// prints the message of the code at once. the cursor move of
+// PROTO_FINECHOICE is only gathered, and reaches the terminal along with the
+// frame drawn after it
 short proto_out(short proto)
 {
+	MetricTimer timer(proto_out_latency);
+	term_frame.at_top = false;
 	switch (proto) {
 	case PROTO_IMTHINKING:
-		cout << termcolor::blink << "I'm thinking..." << termcolor::reset << endl;
+		term_out << termcolor::blink << "I'm thinking..." << termcolor::reset << '\n';
 		break;
 	case PROTO_BADCHOICE:
-		cout << termcolor::red <<
-			"That cell is occupied!" << termcolor::reset << endl;
+		term_out << termcolor::red <<
+			"That cell is occupied!" << termcolor::reset << '\n' << flush;
 		unisleep(2);
-		cout << "\e[2K\e[1A\e[2K\e[1A";
+		term_out << "\e[2K\e[1A\e[2K\e[1A";
 		break;
 	case PROTO_FINECHOICE:
 		// clear the message and relocate the cursor
-		cout << "\e[1A\e[2K\e[7A\r";
-		break;
+		term_out << "\e[1A\e[2K\e[" << 2 * term_board_rows + 1 << "A\r";
+		term_frame.at_top = term_frame.width > 0;
+		return 0;
 	case PROTO_GAMEDONE:
-		cout << "\e[2K";
+		term_out << "\e[2K";
 		break;
 	case PROTO_IWIN:
-		cout << termcolor::green << "I win. Ha!" << termcolor::reset << endl;
+		term_out << termcolor::green << "I win. Ha!" << termcolor::reset << '\n';
 		break;
 	case PROTO_UWIN:
-		cout << termcolor::red << "You win. Sad." << termcolor::reset << endl;
+		term_out << termcolor::red << "You win. Sad." << termcolor::reset << '\n';
 		break;
 	case PROTO_TIE:
-		cout << termcolor::underline << "Draw!" << termcolor::reset << endl;
+		term_out << termcolor::underline << "Draw!" << termcolor::reset << '\n';
 		break;
 	default:
-		cout << termcolor::on_red << termcolor::white <<
-			"Bad protocol: " << proto << termcolor::reset << endl;
+		term_out << termcolor::on_red << termcolor::white <<
+			"Bad protocol: " << proto << termcolor::reset << '\n' << flush;
 		return 1;
 	}
+	term_out << flush;
 	return 0;
 }
 
 short proto_query(short proto_out)
 {
+	MetricTimer timer(proto_query_latency);
+	term_frame.at_top = false;
 	switch (proto_out) {
-	case PROTO_WHOFIRST:
-		cout << termcolor::yellow << "1 for machine first, 0 for you first >";
+	case PROTO_WHOFIRST: {
+		term_out << termcolor::yellow << "1 for machine first, 0 for you first >"
+			<< flush;
 		bool machfirst;
 		cin >> machfirst;
-		cout << "Difficulty? (1,2,3) >";
+		term_out << "Difficulty? (1,2,3) >" << flush;
 		short diff;
 		cin >> diff;
 		return (machfirst ? 1 : -1) * diff;
+	}
 
 	case PROTO_WHATCELL: {
-		cout << termcolor::yellow;
-		short ch = get_short_range("Which cell do you choose? >", -1, 9);
-		cout << termcolor::reset;
+		term_out << termcolor::yellow;
+		short ch = get_short_range("Which cell do you choose? >", -1,
+				term_board_cells);
+		term_out << termcolor::reset;
 		return ch;
 	}
 
 	case PROTO_AGAIN:
-		cout << termcolor::yellow;
+		term_out << termcolor::yellow;
 		return get_short_range("Again? >", -1, 2);
 
 	default:
-		cout << termcolor::on_red << termcolor::white <<
-			"Bad protocol: " << proto_out << termcolor::reset << endl;
+		term_out << termcolor::on_red << termcolor::white <<
+			"Bad protocol: " << proto_out << termcolor::reset << '\n' << flush;
 		return -1;
 	}
 }
 
-// retrieves the cell of given index from the board and adds appropriate prefix
-// to the char, specified by the DEFINEs below.
+/* ========== Board Rendering ========== */
+
+// prints the cell of given index from the board, with the color of whoever
+// played it if asked to, as specified by the DEFINEs below
 #define MACHINE_CELL termcolor::magenta
 #define PLAYER_CELL termcolor::cyan
-const string paint_choice(const Board& board, unsigned short index)
+template <class G>
+void paint_choice(ostream& out, const Board<G>& board, unsigned short index,
+		bool with_color, char machine)
+{
+	log_event<G>(LOG_PAINT_CHOICE, 0, index, board);
+	if (with_color) {
+		out << (board[index] == machine ? MACHINE_CELL : PLAYER_CELL)
+			<< board[index] << termcolor::reset;
+	} else {
+		out << board[index];
+	}
+}
+
+// gathers the whole frame of the board in term_out, from the cursor down
+template <class G>
+void render_full_board(const Board<G>& board, bool with_color, char machine)
 {
-	debug_file << "paint_choice: board=" << board_to_string(board)
-		<< ",index=" << index << endl;
-	stringstream sstr;
-	sstr << (board[index] == machine ? MACHINE_CELL : PLAYER_CELL) << board[index];
-	sstr << termcolor::reset;
-	debug_file << "paint_choice: result=" << sstr.str() << endl;
-	return sstr.str();
+	grid_border(term_out, G::WIDTH, "┌", "┬", "┐");
+	term_out << '\n';
+	for (unsigned short row = 0; row < G::HEIGHT; ++row) {
+		if (row > 0) {
+			grid_border(term_out, G::WIDTH, "├", "┼", "┤");
+			term_out << '\n';
+		}
+		log_event<G>(LOG_BOARD_ROW, 0, row * G::WIDTH, board);
+		term_out << "│";
+		for (unsigned short i = row * G::WIDTH; i < (row + 1) * G::WIDTH; ++i) {
+			term_out << ' ';
+			paint_choice<G>(term_out, board, i, with_color, machine);
+			term_out << " │";
+		}
+		term_out << '\n';
+	}
+	grid_border(term_out, G::WIDTH, "└", "┴", "┘");
+	term_out << '\n' << termcolor::reset;
 }
 
-// shorthand function for print_board_row
-const string paint_choice_if(const Board& b, unsigned short i, bool do_)
+// gathers in term_out what turns the last frame, with the cursor at its top,
+// into the frame of the board: a move to each cell that changed and its new
+// mark, then a move to the line below the frame
+template <class G>
+void render_changed_cells(const Board<G>& board, bool with_color, char machine)
 {
-	return (do_ ?
-			paint_choice(b, i) :
-			to_string(b[i]));
+	unsigned line = 0;
+	for (unsigned short i = 0; i < G::CELLS; ++i) {
+		if (board[i] == term_frame.cells[i])
+			continue;
+		// rows of cells lie between border lines, each cell 4 columns wide
+		unsigned cell_line = 2 * (i / G::WIDTH) + 1;
+		if (cell_line > line)
+			term_out << "\e[" << cell_line - line << 'B';
+		line = cell_line;
+		term_out << "\r\e[" << 4 * (i % G::WIDTH) + 2 << 'C';
+		paint_choice<G>(term_out, board, i, with_color, machine);
+	}
+	term_out << "\e[" << 2 * G::HEIGHT + 1 - line << "B\r" << termcolor::reset;
 }
 
-// returns a row of the board for use by print_board ONLY
-const string print_board_row(const Board& board, bool with_color,
-		unsigned short sindex)
+// gathers the frame of the board in term_out. over the last frame, only the
+// cells that changed are drawn again
+template <class G>
+void render_board(const Board<G>& board, bool with_color, char machine)
 {
-	debug_file << "print_board_row: " << board_to_string(board) << ","
-		<< with_color << "," << sindex << endl;
-	stringstream sstr;
-	sstr << "│ " <<
-		paint_choice_if(board, sindex, with_color)
-		<< " │ " <<
-		paint_choice_if(board, sindex+1, with_color)
-		<< " │ " <<
-		paint_choice_if(board, sindex+2, with_color)
-		<< " │" << endl;
-	debug_file << "print_board_row: result=" << sstr.str() << endl;
-	return sstr.str();
+	if (term_frame.at_top && term_frame.width == G::WIDTH &&
+			term_frame.height == G::HEIGHT &&
+			term_frame.with_color == with_color && term_frame.machine == machine)
+		render_changed_cells<G>(board, with_color, machine);
+	else
+		render_full_board<G>(board, with_color, machine);
+
+	copy(board.begin(), board.end(), term_frame.cells);
+	term_frame.width = G::WIDTH;
+	term_frame.height = G::HEIGHT;
+	term_frame.with_color = with_color;
+	term_frame.machine = machine;
+	term_frame.at_top = false;
+	term_board_rows = G::HEIGHT;
+	term_board_cells = G::CELLS;
 }
 
-// prints the board parameter in a way that humans understand.
-void print_board(const Board& board, bool with_color)
+// prints the board parameter in a way that humans understand, in one write
+// along with any cursor move gathered before it
+template <class G>
+void print_board(const Board<G>& board, bool with_color, char machine)
 {
-		cout  << "┌───┬───┬───┐" << endl
-					<< print_board_row(board, with_color, 0)
-					<< "├───┼───┼───┤" << endl
-					<< print_board_row(board, with_color, 3)
-					<< "├───┼───┼───┤" << endl
-					<< print_board_row(board, with_color, 6)
-					<< "└───┴───┴───┘" << endl << termcolor::reset;
+	render_board<G>(board, with_color, machine);
+	term_out << flush;
 }
 
-// constructs a board object from string.
-Board board_from_string(string str_)
+// constructs a board object from string. cells past the end of the string
+// are empty, and chars past the last cell are ignored
+template <class G>
+Board<G> board_from_string(string str_)
 {
-	Board output;
-	copy(str_.begin(), str_.end(), output.data());
+	Board<G> output;
+	output.fill(' ');
+	copy_n(str_.begin(), min(str_.size(), size_t(G::CELLS)), output.begin());
 	return output;
 }
 
 // constructs a board through user input.
-Board board_from_input()
+template <class G>
+Board<G> board_from_input()
 {
-	cout << "Please type the board below" << endl;
+	term_out << "Please type the board below" << endl;
 	stringstream boardstr;
 
 	// used in the loop, declared outside
 	string segment;
-	for (size_t i = 0; i < 3; ++i) {
-		cout << "Row " << i+1 << " >>";
+	for (size_t i = 0; i < G::HEIGHT; ++i) {
+		term_out << "Row " << i+1 << " >>" << flush;
 		getline(cin, segment);
 		boardstr << segment;
 	}
 
-	return board_from_string(boardstr.str());
+	return board_from_string<G>(boardstr.str());
 }
 
-Board board_in()
+template <class G>
+Board<G> board_in()
 {
-	return board_from_input();
+	return board_from_input<G>();
 }
 
-short board_out(const Board& brd)
+template <class G>
+short board_out(const Board<G>& brd, char machine)
 {
-	print_board(brd, true);
+	MetricTimer timer(render_latency);
+	print_board<G>(brd, true, machine);
 	return 0;
 }
 
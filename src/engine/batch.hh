@@ -0,0 +1,226 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  batch.hh
+ *
+ *    Description:  Win detection over blocks of boards with SIMD kernels
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 04:40:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_BATCH
+#define TTT_ENGINE_BATCH
+
+#include <cstring>
+
+// the SIMD kernels are built with GCC vector extensions and per-function
+// target attributes, so they need GCC or clang on x86; elsewhere only the
+// scalar kernel exists
+#if (defined(__GNUC__) || defined(__clang__)) && \
+	(defined(__x86_64__) || defined(__i386__))
+#define TTT_BATCH_SIMD
+#endif
+
+/* ========== Board Blocks ========== */
+
+// number of boards per block
+#define BATCH_BOARDS 32
+
+// a block of boards stored as a structure of arrays, the x masks of every
+// board then the o masks, so that a kernel loads many boards at once
+template <class G>
+struct BoardBlock {
+	alignas(32) typename G::Mask x[BATCH_BOARDS];
+	alignas(32) typename G::Mask o[BATCH_BOARDS];
+};
+
+// a kernel writes the winner of every board of count blocks, the same as
+// board_winner would: 'x', 'o', or ' ' for no winner
+template <class G>
+using WinnersKernel = void (*)(const BoardBlock<G>*, size_t, char*);
+
+/* ========== Kernels ========== */
+
+// the reference kernel, board_winner on each board in turn
+template <class G>
+void block_winners_scalar(const BoardBlock<G>* blocks, size_t count, char* winners)
+{
+	for (size_t i = 0; i < count * BATCH_BOARDS; ++i) {
+		const BoardBlock<G>& block = blocks[i / BATCH_BOARDS];
+		winners[i] = board_winner(BitBoard<G>{block.x[i % BATCH_BOARDS],
+			block.o[i % BATCH_BOARDS]});
+	}
+}
+
+#ifdef TTT_BATCH_SIMD
+
+// returns the cells a line can start from that goes rows down and cols
+// across from one cell to the next, which is always to a higher cell
+template <class G>
+constexpr typename G::Mask line_starts(int rows, int cols)
+{
+	typename G::Mask starts = 0;
+	for (int row = 0; row < int(G::HEIGHT); ++row) {
+		for (int col = 0; col < int(G::WIDTH); ++col) {
+			int last_row = row + rows * int(G::LENGTH - 1);
+			int last_col = col + cols * int(G::LENGTH - 1);
+			if (last_row < int(G::HEIGHT) && last_col >= 0 && last_col < int(G::WIDTH))
+				starts |= typename G::Mask(1) << (row * G::WIDTH + col);
+		}
+	}
+	return starts;
+}
+
+// doubles the runs of marks, LENGTH cells long with STEP cells from one to
+// the next, until they are a line long. a mark is left where a run starts
+template <class G, unsigned STEP, unsigned LENGTH = 1, class Lanes>
+__attribute__((always_inline))
+inline typename enable_if<LENGTH >= G::LENGTH>::type extend_runs(Lanes&)
+{
+}
+
+template <class G, unsigned STEP, unsigned LENGTH = 1, class Lanes>
+__attribute__((always_inline))
+inline typename enable_if<LENGTH < G::LENGTH>::type extend_runs(Lanes& runs)
+{
+	const unsigned more = LENGTH < G::LENGTH - LENGTH ? LENGTH : G::LENGTH - LENGTH;
+	runs &= runs >> (more * STEP);
+	extend_runs<G, STEP, LENGTH + more>(runs);
+}
+
+// sets in open the lanes whose marks fill no line, with all bits. each
+// direction costs a few shifts for every line of it at once
+template <class G, class Lanes>
+__attribute__((always_inline))
+inline void lanes_open(const Lanes& marks, Lanes& open)
+{
+	constexpr typename G::Mask ROWS = line_starts<G>(0, 1);
+	constexpr typename G::Mask COLUMNS = line_starts<G>(1, 0);
+	constexpr typename G::Mask DIAGONALS = line_starts<G>(1, 1);
+	constexpr typename G::Mask ANTIDIAGONALS = line_starts<G>(1, -1);
+	Lanes rows = marks, columns = marks, diagonals = marks, antidiagonals = marks;
+	extend_runs<G, 1>(rows);
+	extend_runs<G, G::WIDTH>(columns);
+	extend_runs<G, G::WIDTH + 1>(diagonals);
+	extend_runs<G, G::WIDTH - 1>(antidiagonals);
+	open = (Lanes)(((rows & ROWS) | (columns & COLUMNS) |
+		(diagonals & DIAGONALS) | (antidiagonals & ANTIDIAGONALS)) == 0);
+}
+
+// checks LANES boards at a time, with one mask per vector lane. only ever
+// inlined into the kernels below, which decide the instruction set
+template <class G, size_t LANES>
+__attribute__((always_inline))
+inline void block_winners_lanes(const BoardBlock<G>* blocks, size_t count,
+		char* winners)
+{
+	typedef typename G::Mask Mask;
+	typedef Mask Lanes __attribute__((vector_size(sizeof(Mask) * LANES)));
+	typedef char Chars __attribute__((vector_size(LANES)));
+
+	for (const BoardBlock<G>* block = blocks; block < blocks + count;
+			++block, winners += BATCH_BOARDS) {
+		// lanes where either player filled no line, over the whole block
+		Lanes either_open = ~Lanes{};
+		for (size_t base = 0; base < BATCH_BOARDS; base += LANES) {
+			Lanes x, o;
+			memcpy(&x, block->x + base, sizeof x);
+			memcpy(&o, block->o + base, sizeof o);
+			Lanes x_open, o_open;
+			lanes_open<G>(x, x_open);
+			lanes_open<G>(o, o_open);
+			either_open &= x_open | o_open;
+
+			// ' ', turned into 'x' or 'o' by flipping the bits they differ in
+			Lanes result = (~x_open & Mask(' ' ^ 'x')) ^
+				(~o_open & Mask(' ' ^ 'o')) ^ Mask(' ');
+			Chars chars = __builtin_convertvector(result, Chars);
+			memcpy(winners + base, &chars, sizeof chars);
+		}
+
+		// when both players filled lines, which a real game never gets to,
+		// board_winner reports the first filled line in order, x before o on
+		// the same line: the block is left to it
+		uint64_t words[sizeof either_open / sizeof(uint64_t)];
+		uint64_t all_open = ~uint64_t(0);
+		memcpy(words, &either_open, sizeof either_open);
+		for (uint64_t word: words)
+			all_open &= word;
+		if (~all_open)
+			block_winners_scalar(block, 1, winners);
+	}
+}
+
+template <class G>
+__attribute__((target("sse2")))
+void block_winners_sse2(const BoardBlock<G>* blocks, size_t count, char* winners)
+{
+	block_winners_lanes<G, 16 / sizeof(typename G::Mask)>(blocks, count, winners);
+}
+
+template <class G>
+__attribute__((target("avx2")))
+void block_winners_avx2(const BoardBlock<G>* blocks, size_t count, char* winners)
+{
+	block_winners_lanes<G, 32 / sizeof(typename G::Mask)>(blocks, count, winners);
+}
+
+#endif
+
+// returns the fastest kernel the processor running the program supports,
+// checked once. SSE2 can't compare 64-bit lanes, so boards that need them
+// only go wide with AVX2
+template <class G>
+WinnersKernel<G> block_winners_kernel()
+{
+#ifdef TTT_BATCH_SIMD
+	static const WinnersKernel<G> kernel =
+		__builtin_cpu_supports("avx2") ? block_winners_avx2<G> :
+		__builtin_cpu_supports("sse2") && sizeof(typename G::Mask) < 8 ?
+			block_winners_sse2<G> : block_winners_scalar<G>;
+	return kernel;
+#else
+	return block_winners_scalar<G>;
+#endif
+}
+
+/* ========== Batches ========== */
+
+// writes the winners of the count blocks into winners, BATCH_BOARDS per
+// block, with the fastest kernel. callers that can lay their boards out as
+// blocks in the first place skip the copy board_winners makes
+template <class G>
+void block_winners(const BoardBlock<G>* blocks, size_t count, char* winners)
+{
+	block_winners_kernel<G>()(blocks, count, winners);
+}
+
+// writes the winner of each of the count boards into winners, as board_winner
+// would, copying them into a block at a time
+template <class G>
+void board_winners(const BitBoard<G>* boards, size_t count, char* winners)
+{
+	WinnersKernel<G> kernel = block_winners_kernel<G>();
+	BoardBlock<G> block;
+	for (; count >= BATCH_BOARDS; count -= BATCH_BOARDS) {
+		for (size_t i = 0; i < BATCH_BOARDS; ++i) {
+			block.x[i] = boards[i].x;
+			block.o[i] = boards[i].o;
+		}
+		kernel(&block, 1, winners);
+		boards += BATCH_BOARDS;
+		winners += BATCH_BOARDS;
+	}
+	for (size_t i = 0; i < count; ++i)
+		winners[i] = board_winner(boards[i]);
+}
+
+#endif
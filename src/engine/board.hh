@@ -0,0 +1,402 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  board.hh
+ *
+ *    Description:  Board geometry and bitboards for m,n,k games
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:12:41 AM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_BOARD
+#define TTT_ENGINE_BOARD
+
+#include <cstdint>
+#include <type_traits>
+
+/* ========== Geometry ========== */
+
+// a board W cells wide and H cells high, where K in a row wins.
+// cell i is at row i / W, column i % W.
+template <unsigned W, unsigned H, unsigned K>
+struct Geometry {
+	static_assert(K >= 1 && (K <= W || K <= H), "lines must fit on the board");
+	static_assert(W * H <= 64, "boards are held in 64-bit masks");
+
+	static constexpr unsigned WIDTH = W;
+	static constexpr unsigned HEIGHT = H;
+	static constexpr unsigned LENGTH = K;
+	static constexpr unsigned CELLS = W * H;
+
+	// one bit per cell
+	typedef typename conditional<CELLS <= 16, uint16_t,
+		typename conditional<CELLS <= 32, uint32_t, uint64_t>::type>::type Mask;
+	static constexpr Mask FULL = CELLS == 64 ? ~Mask(0) : Mask((uint64_t(1) << CELLS) - 1);
+
+	// score of a win on the first ply; wins found deeper score one less per ply
+	static constexpr int WIN = CELLS + 1;
+
+	// horizontal, vertical and both diagonal lines of length K
+	static constexpr unsigned LINES =
+		(W >= K ? H * (W - K + 1) : 0) +
+		(H >= K ? W * (H - K + 1) : 0) +
+		(W >= K && H >= K ? 2 * (W - K + 1) * (H - K + 1) : 0);
+
+	// squares have all 8 symmetries, other rectangles only the first 4
+	static constexpr unsigned TRANSFORMS = W == H ? 8 : 4;
+};
+
+template <unsigned W, unsigned H, unsigned K> constexpr unsigned Geometry<W, H, K>::WIDTH;
+template <unsigned W, unsigned H, unsigned K> constexpr unsigned Geometry<W, H, K>::HEIGHT;
+template <unsigned W, unsigned H, unsigned K> constexpr unsigned Geometry<W, H, K>::LENGTH;
+template <unsigned W, unsigned H, unsigned K> constexpr unsigned Geometry<W, H, K>::CELLS;
+template <unsigned W, unsigned H, unsigned K>
+constexpr typename Geometry<W, H, K>::Mask Geometry<W, H, K>::FULL;
+template <unsigned W, unsigned H, unsigned K> constexpr int Geometry<W, H, K>::WIN;
+template <unsigned W, unsigned H, unsigned K> constexpr unsigned Geometry<W, H, K>::LINES;
+template <unsigned W, unsigned H, unsigned K> constexpr unsigned Geometry<W, H, K>::TRANSFORMS;
+
+// the classic game
+typedef Geometry<3, 3, 3> Classic;
+
+// winning lines as cell masks
+template <class G>
+struct LineTable {
+	typename G::Mask masks[G::LINES];
+
+	constexpr LineTable() : masks()
+	{
+		// starting cell and step between cells of each direction
+		const int steps[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+		unsigned line = 0;
+		for (auto& step: steps) {
+			for (int row = 0; row < int(G::HEIGHT); ++row) {
+				for (int col = 0; col < int(G::WIDTH); ++col) {
+					int last_row = row + step[0] * int(G::LENGTH - 1);
+					int last_col = col + step[1] * int(G::LENGTH - 1);
+					if (last_row >= int(G::HEIGHT) ||
+							last_col < 0 || last_col >= int(G::WIDTH))
+						continue;
+					for (int i = 0; i < int(G::LENGTH); ++i) {
+						masks[line] |= typename G::Mask(1) <<
+							((row + step[0] * i) * G::WIDTH + col + step[1] * i);
+					}
+					++line;
+				}
+			}
+		}
+	}
+};
+template <class G>
+constexpr LineTable<G> WIN_LINES = LineTable<G>();
+
+// returns the number of winning lines through each cell
+template <class G>
+constexpr unsigned lines_through(unsigned cell)
+{
+	unsigned count = 0;
+	for (auto line: WIN_LINES<G>.masks) {
+		if (line & (typename G::Mask(1) << cell))
+			++count;
+	}
+	return count;
+}
+
+// returns the number of distinct counts of lines through a cell
+template <class G>
+constexpr unsigned count_order_groups()
+{
+	unsigned count = 0;
+	for (unsigned cell = 0; cell < G::CELLS; ++cell) {
+		bool seen = false;
+		for (unsigned before = 0; before < cell; ++before)
+			seen = seen || lines_through<G>(before) == lines_through<G>(cell);
+		if (!seen)
+			++count;
+	}
+	return count;
+}
+
+// cells grouped by how many lines run through them, busiest first. moves are
+// searched in this order, e.g. center, corners, then edges on the 3x3 board.
+template <class G>
+struct OrderTable {
+	static constexpr unsigned GROUPS = count_order_groups<G>();
+	typename G::Mask groups[GROUPS];
+
+	constexpr OrderTable() : groups()
+	{
+		unsigned group = 0;
+		for (unsigned lines = G::LINES; group < GROUPS; --lines) {
+			for (unsigned cell = 0; cell < G::CELLS; ++cell) {
+				if (lines_through<G>(cell) == lines)
+					groups[group] |= typename G::Mask(1) << cell;
+			}
+			if (groups[group])
+				++group;
+		}
+	}
+};
+template <class G> constexpr unsigned OrderTable<G>::GROUPS;
+template <class G>
+constexpr OrderTable<G> MOVE_ORDER = OrderTable<G>();
+
+/* ========== Bitboard Manipulation ========== */
+
+// engine board: one occupancy mask per player, bit i is cell i
+template <class G>
+struct BitBoard {
+	typename G::Mask x;
+	typename G::Mask o;
+};
+
+// the classic engine board
+typedef BitBoard<Classic> ClassicBoard;
+
+// index of the lowest set bit; mask must not be 0
+constexpr unsigned short lowest_cell(uint64_t mask)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(mask);
+#else
+	unsigned short i = 0;
+	while (!(mask & 1)) {
+		mask >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
+// number of set bits in the mask
+constexpr unsigned short cell_count(uint64_t mask)
+{
+#ifdef __GNUC__
+	return __builtin_popcountll(mask);
+#else
+	unsigned short count = 0;
+	for (; mask; mask &= mask - 1)
+		++count;
+	return count;
+#endif
+}
+
+// deduces the winner of the board.
+// return values: 'o', 'x', or ' ' for no winner
+template <class G>
+constexpr char board_winner(const BitBoard<G>& board)
+{
+	for (auto win_mask: WIN_LINES<G>.masks) {
+		if ((board.x & win_mask) == win_mask)
+			return 'x';
+		if ((board.o & win_mask) == win_mask)
+			return 'o';
+	}
+
+	// No winners found - could be completely full, could be partly occupied
+	return ' ';
+}
+
+// returns whether the marks fill any winning line
+template <class G>
+constexpr bool has_line(typename G::Mask marks)
+{
+	for (auto win_mask: WIN_LINES<G>.masks) {
+		if ((marks & win_mask) == win_mask)
+			return true;
+	}
+	return false;
+}
+
+// returns whether the marks of the board could come from a real game: x has
+// as many marks as o or one more, and a line, if any, belongs to whoever
+// moved last, since the game ends with it
+template <class G>
+constexpr bool is_reachable(const BitBoard<G>& board)
+{
+	int marks_ahead = cell_count(board.x) - cell_count(board.o);
+	if (marks_ahead != 0 && marks_ahead != 1)
+		return false;
+	if (has_line<G>(board.x))
+		return marks_ahead == 1 && !has_line<G>(board.o);
+	return !has_line<G>(board.o) || marks_ahead == 0;
+}
+
+// returns a mask of the cells that are empty.
+template <class G>
+constexpr typename G::Mask empty_mask(const BitBoard<G>& board)
+{
+	return ~(board.x | board.o) & G::FULL;
+}
+
+// returns whether the given board is full and needs to be disposed.
+template <class G>
+constexpr bool is_full(const BitBoard<G>& board)
+{
+	return (board.x | board.o) == G::FULL;
+}
+
+// returns the player to move; x moves whenever both have the same number of marks
+template <class G>
+constexpr char to_move(const BitBoard<G>& board)
+{
+	return cell_count(board.x) == cell_count(board.o) ? 'x' : 'o';
+}
+
+// places the player's mark on the given cell
+template <class G>
+inline void place(BitBoard<G>& board, char player, short index)
+{
+	(player == 'x' ? board.x : board.o) |= typename G::Mask(1) << index;
+}
+
+// returns a mask of the empty cells that would complete a line of own marks
+template <class G>
+constexpr typename G::Mask winning_cells(typename G::Mask own,
+		typename G::Mask empties)
+{
+	typename G::Mask output = 0;
+	for (auto win_mask: WIN_LINES<G>.masks) {
+		// the one cell missing from the line must be empty
+		if (cell_count(own & win_mask) == G::LENGTH - 1)
+			output |= win_mask & empties;
+	}
+	return output;
+}
+
+// returns a completely sanitary board for new games.
+template <class G>
+constexpr BitBoard<G> clean_board()
+{
+	return BitBoard<G> {0, 0};
+}
+
+/* ========== Symmetry ========== */
+
+// where cell (row, col) of a square board of the given size moves under each
+// transform. the first 4 transforms also work on other rectangles.
+constexpr unsigned transform_cell(unsigned transform, unsigned width,
+		unsigned height, unsigned row, unsigned col)
+{
+	switch (transform) {
+		case 1: // rotate 180
+			return (height - 1 - row) * width + (width - 1 - col);
+		case 2: // mirror left-right
+			return row * width + (width - 1 - col);
+		case 3: // mirror top-bottom
+			return (height - 1 - row) * width + col;
+		case 4: // rotate 90 clockwise
+			return col * width + (width - 1 - row);
+		case 5: // rotate 270 clockwise
+			return (width - 1 - col) * width + row;
+		case 6: // mirror on the main diagonal
+			return col * width + row;
+		case 7: // mirror on the anti-diagonal
+			return (width - 1 - col) * width + (width - 1 - row);
+		default: // identity
+			return row * width + col;
+	}
+}
+
+// the transform that undoes each transform
+constexpr unsigned short INVERSE_SYMMETRIES[8] = {0, 1, 2, 3, 5, 4, 6, 7};
+
+// every transform applied to masks a chunk of bits at a time: the image of a
+// mask is the union of the images of its chunks. small boards fit in one chunk.
+template <class G>
+struct SymmetryTable {
+	static constexpr unsigned CHUNK_BITS = G::CELLS <= 12 ? G::CELLS : 8;
+	static constexpr unsigned CHUNKS = (G::CELLS + CHUNK_BITS - 1) / CHUNK_BITS;
+	typename G::Mask chunks[G::TRANSFORMS][CHUNKS][1 << CHUNK_BITS];
+
+	constexpr SymmetryTable() : chunks()
+	{
+		for (unsigned t = 0; t < G::TRANSFORMS; ++t) {
+			for (unsigned chunk = 0; chunk < CHUNKS; ++chunk) {
+				for (unsigned bits = 0; bits < (1u << CHUNK_BITS); ++bits) {
+					for (unsigned bit = 0; bit < CHUNK_BITS; ++bit) {
+						unsigned cell = chunk * CHUNK_BITS + bit;
+						if (!(bits & (1 << bit)) || cell >= G::CELLS)
+							continue;
+						chunks[t][chunk][bits] |= typename G::Mask(1) <<
+							transform_cell(t, G::WIDTH, G::HEIGHT,
+									cell / G::WIDTH, cell % G::WIDTH);
+					}
+				}
+			}
+		}
+	}
+};
+template <class G> constexpr unsigned SymmetryTable<G>::CHUNK_BITS;
+template <class G> constexpr unsigned SymmetryTable<G>::CHUNKS;
+template <class G>
+constexpr SymmetryTable<G> SYMMETRY = SymmetryTable<G>();
+
+// returns the mask under the given transform
+template <class G>
+constexpr typename G::Mask transform_mask(typename G::Mask mask, unsigned short transform)
+{
+	typedef SymmetryTable<G> Table;
+	typename G::Mask output = 0;
+	for (unsigned chunk = 0; chunk < Table::CHUNKS; ++chunk) {
+		output |= SYMMETRY<G>.chunks[transform][chunk]
+			[(mask >> (chunk * Table::CHUNK_BITS)) & ((1 << Table::CHUNK_BITS) - 1)];
+	}
+	return output;
+}
+
+// returns the board under the given transform
+template <class G>
+constexpr BitBoard<G> transform_board(const BitBoard<G>& board, unsigned short transform)
+{
+	return BitBoard<G> {transform_mask<G>(board.x, transform),
+		transform_mask<G>(board.o, transform)};
+}
+
+// returns whether a comes before b in the canonical ordering of boards
+template <class G>
+constexpr bool board_less(const BitBoard<G>& a, const BitBoard<G>& b)
+{
+	return a.x < b.x || (a.x == b.x && a.o < b.o);
+}
+
+// returns the transform that maps the board onto its canonical form, the
+// first of its images in board_less order
+template <class G>
+constexpr unsigned short canonical_transform(const BitBoard<G>& board)
+{
+	unsigned short best_transform = 0;
+	BitBoard<G> best = board;
+	for (unsigned short t = 1; t < G::TRANSFORMS; ++t) {
+		BitBoard<G> image = transform_board(board, t);
+		if (board_less(image, best)) {
+			best = image;
+			best_transform = t;
+		}
+	}
+	return best_transform;
+}
+
+// returns the canonical form of the board, which is the same for all boards
+// that are rotations or reflections of each other
+template <class G>
+constexpr BitBoard<G> canonical_board(const BitBoard<G>& board)
+{
+	return transform_board(board, canonical_transform(board));
+}
+
+template <class G>
+constexpr bool operator==(const BitBoard<G>& a, const BitBoard<G>& b)
+{
+	return a.x == b.x && a.o == b.o;
+}
+
+#endif
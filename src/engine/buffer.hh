@@ -0,0 +1,53 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  buffer.hh
+ *
+ *    Description:  Fixed-capacity containers that live on the stack
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:12:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_BUFFER
+#define TTT_ENGINE_BUFFER
+
+#include <cstddef>
+
+/* ========== Fixed Vector ========== */
+
+// A vector of at most N items stored inline, so that the search can keep its
+// lists without touching the heap. Items must be default constructible, and
+// N must be large enough for every push; it is not checked.
+template <class T, size_t N>
+struct FixedVector {
+	T items[N];
+	size_t count = 0;
+
+	void push_back(const T& item)
+	{
+		items[count++] = item;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	void clear() { count = 0; }
+
+	T& operator[](size_t index) { return items[index]; }
+	const T& operator[](size_t index) const { return items[index]; }
+	T& back() { return items[count - 1]; }
+
+	T* begin() { return items; }
+	T* end() { return items + count; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  context.hh
+ *
+ *    Description:  Engine contexts: everything one machine player needs to choose
+ *                  moves, so that any number of them play at once
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:34:05 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_CONTEXT
+#define TTT_ENGINE_CONTEXT
+
+/* ========== Engine Context ========== */
+
+// one machine player: the mark it plays, its strategy and limits per move,
+// its random choices and what its decisions took. a context belongs to one
+// game and is used by one thread at a time; contexts of different games may
+// be used by any threads at once. what they share, the transposition tables,
+// the search pool and the metrics, is safe to share
+struct EngineContext {
+	EngineContext(char machine, short difficulty, long move_time,
+			unsigned long move_nodes, uint64_t seed) :
+		machine(machine), difficulty(difficulty), move_time(move_time),
+		move_nodes(move_nodes), parallel(true), random(seed), decisions(0),
+		decision_ns(0), nodes(0)
+	{
+	}
+
+	// 'x' or 'o', and the difficulty of the strategy, as strategy_move takes it
+	char machine;
+	short difficulty;
+
+	// milliseconds and nodes each decision may search (0 for no limit)
+	long move_time;
+	unsigned long move_nodes;
+
+	// whether searches split their root moves across the search pool. must be
+	// off for contexts used on pool threads, which can't wait for the pool
+	bool parallel;
+
+	// seeds every decision, so the same seed replays the same moves
+	Random random;
+
+	// the result of the last decision, and totals over every decision
+	SearchResult last;
+	unsigned long decisions;
+	uint64_t decision_ns;
+	unsigned long nodes;
+};
+
+// searches the board with the limits of the context and adds the result to
+// its statistics
+template <class G>
+const SearchResult& engine_decide(EngineContext& context, short difficulty,
+		const BitBoard<G>& board)
+{
+	SearchLimits limits(context.move_time, context.move_nodes, context.random());
+	limits.parallel = context.parallel;
+	context.last = strategy_move(difficulty, board, limits);
+	++context.decisions;
+	context.decision_ns += context.last.elapsed_ns;
+	context.nodes += context.last.nodes;
+	return context.last;
+}
+
+// returns the move of the context's strategy, or -1 if the game is over, it
+// isn't the machine's turn, or the difficulty is unknown. the whole result is
+// left in context.last
+template <class G>
+short best_move(EngineContext& context, const BitBoard<G>& board)
+{
+	if (to_move(board) != context.machine) {
+		context.last = SearchResult();
+		return -1;
+	}
+	return engine_decide(context, context.difficulty, board).move;
+}
+
+// returns the best moves and the score of every move of the player to move,
+// whatever the difficulty or mark of the context, searched within its limits.
+// scores are from the view of the player to move
+template <class G>
+SearchResult evaluate(EngineContext& context, const BitBoard<G>& board)
+{
+	return engine_decide(context, 2, board);
+}
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  eventlog.hh
+ *
+ *    Description:  Binary event log: a lock-free ring of fixed-size records, drained
+ *                  to a file by a thread of its own, and the decoder that turns a
+ *                  log back into text
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:48:31 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_EVENTLOG
+#define TTT_ENGINE_EVENTLOG
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+/* ========== Records ========== */
+
+// what a record tells. the value of each is given after it
+enum LogEvent : unsigned char {
+	LOG_DROPPED,        // records lost since the last drain
+	LOG_MOVE,           // the cell played, with the board after the move
+	LOG_RESULT,         // the machine's move
+	LOG_SCORE,          // the score of the machine's move
+	LOG_DEPTH,          // the depth its search reached
+	LOG_NODES,          // the nodes it searched
+	LOG_ELAPSED,        // the microseconds it took
+	LOG_INPUT,          // a number typed in
+	LOG_INPUT_DONE,     // the number accepted
+	LOG_PAINT_CHOICE,   // the cell painted, with the board
+	LOG_BOARD_ROW,      // the first cell of the row printed, with the board
+	LOG_EVENTS
+};
+
+const char* const LOG_EVENT_NAMES[LOG_EVENTS] = {
+	"dropped", "move", "result", "score", "depth", "nodes",
+	"elapsed_us", "input", "input_done", "paint_choice", "board_row",
+};
+
+// one event. the board, if any, is written by encode_board in as many bytes
+// as its width and height call for, and is absent when they are 0
+struct LogRecord {
+	uint64_t time;          // nanoseconds since the log started
+	LogEvent event;
+	char player;            // 'x', 'o', or 0 for none
+	unsigned char width;
+	unsigned char height;
+	int32_t value;
+	unsigned char board[16];
+};
+
+static_assert(sizeof(LogRecord) == 32, "log records are 32 bytes");
+
+// the header of a log file: LOG_MAGIC, then the wall clock in nanoseconds
+// since the epoch when the log started
+#define LOG_MAGIC "TTTLOG\0\1"
+struct LogHeader {
+	char magic[8];
+	uint64_t started;
+};
+
+/* ========== Event Log ========== */
+
+// records in the ring; a power of two
+#define LOG_RING 16384
+
+// how often the drain thread writes out what the ring holds
+#define LOG_DRAIN_INTERVAL chrono::milliseconds(10)
+
+// a log that only the thread that started it writes to. writing a record
+// copies it into the ring and publishes it with one release store, without
+// locks, system calls or allocation; the drain thread takes whole batches
+// from the ring to the file. when the ring is full, records are dropped
+// rather than waiting, and the drop is logged. records from other threads
+// are dropped the same way
+class EventLog {
+public:
+	EventLog() : file(NULL), enabled(false), head(0), tail(0), dropped(0),
+		stopping(false)
+	{
+	}
+
+	~EventLog()
+	{
+		stop();
+	}
+
+	// starts logging to the file at the path, replacing it, from the calling
+	// thread. returns false if the file couldn't be written
+	bool start(const char* path)
+	{
+		stop();
+		if (!(file = fopen(path, "wb")))
+			return false;
+		LogHeader header;
+		memcpy(header.magic, LOG_MAGIC, sizeof header.magic);
+		header.started = chrono::duration_cast<chrono::nanoseconds>(
+				chrono::system_clock::now().time_since_epoch()).count();
+		fwrite(&header, sizeof header, 1, file);
+
+		began = chrono::steady_clock::now();
+		producer = this_thread::get_id();
+		stopping = false;
+		drainer = thread([this] {
+			unique_lock<mutex> guard(lock);
+			while (!wake.wait_for(guard, LOG_DRAIN_INTERVAL, [this] { return stopping; }))
+				drain();
+		});
+		enabled.store(true, memory_order_release);
+		return true;
+	}
+
+	// writes out every record and closes the file
+	void stop()
+	{
+		if (!file)
+			return;
+		enabled.store(false, memory_order_release);
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_one();
+		drainer.join();
+		drain();
+		fclose(file);
+		file = NULL;
+	}
+
+	bool active() const
+	{
+		return enabled.load(memory_order_relaxed);
+	}
+
+	// adds the record to the ring, stamping its time
+	void write(LogRecord& record)
+	{
+		if (this_thread::get_id() != producer) {
+			dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+		uint64_t at = head.load(memory_order_relaxed);
+		if (at - tail.load(memory_order_acquire) == LOG_RING) {
+			dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+		record.time = chrono::duration_cast<chrono::nanoseconds>(
+				chrono::steady_clock::now() - began).count();
+		ring[at & (LOG_RING - 1)] = record;
+		head.store(at + 1, memory_order_release);
+	}
+
+private:
+	// writes what the ring holds to the file, then a record of what was
+	// dropped since the last time, if anything was. only the drain thread
+	// drains until the log stops
+	void drain()
+	{
+		uint64_t from = tail.load(memory_order_relaxed);
+		uint64_t to = head.load(memory_order_acquire);
+		while (from < to) {
+			uint64_t end = min(to, (from | (LOG_RING - 1)) + 1);
+			fwrite(ring + (from & (LOG_RING - 1)), sizeof(LogRecord), end - from, file);
+			from = end;
+		}
+		tail.store(to, memory_order_release);
+
+		if (unsigned long lost = dropped.exchange(0, memory_order_relaxed)) {
+			LogRecord record = {};
+			record.time = chrono::duration_cast<chrono::nanoseconds>(
+					chrono::steady_clock::now() - began).count();
+			record.event = LOG_DROPPED;
+			record.value = int32_t(min(lost, 0x7fffffffUL));
+			fwrite(&record, sizeof record, 1, file);
+		}
+		fflush(file);
+	}
+
+	FILE* file;
+	chrono::steady_clock::time_point began;
+	thread::id producer;
+	atomic<bool> enabled;
+
+	// records written and records drained; each on a cache line of its own,
+	// so the threads don't take the line from each other on every record
+	alignas(64) atomic<uint64_t> head;
+	alignas(64) atomic<uint64_t> tail;
+	atomic<unsigned long> dropped;
+	LogRecord ring[LOG_RING];
+
+	thread drainer;
+	mutex lock;
+	condition_variable wake;
+	bool stopping;
+};
+
+EventLog event_log;
+
+// logs an event without a board. costs one load when the log is off
+inline void log_event(LogEvent event, char player, int32_t value)
+{
+	if (!event_log.active())
+		return;
+	LogRecord record = {};
+	record.event = event;
+	record.player = player;
+	record.value = value;
+	event_log.write(record);
+}
+
+// logs an event with the board
+template <class G>
+inline void log_event(LogEvent event, char player, int32_t value,
+		const BitBoard<G>& board)
+{
+	if (!event_log.active())
+		return;
+	LogRecord record = {};
+	record.event = event;
+	record.player = player;
+	record.value = value;
+	record.width = G::WIDTH;
+	record.height = G::HEIGHT;
+	encode_board(record.board, board);
+	event_log.write(record);
+}
+
+// logs an event with the simplified board, converted only when the log is on
+template <class G>
+inline void log_event(LogEvent event, char player, int32_t value,
+		const Board<G>& board)
+{
+	if (event_log.active())
+		log_event(event, player, value, to_bitboard<G>(board));
+}
+
+/* ========== Decoding ========== */
+
+// writes the board of the record one char per cell, rows split by '/', and
+// returns the end of it
+char* write_log_board(char* out, const LogRecord& record)
+{
+	unsigned cells = record.width * record.height;
+	uint64_t x = 0, o = 0;
+	if (record.width == 3 && record.height == 3) {
+		ClassicBoard board;
+		decode_board(record.board, board);
+		x = board.x;
+		o = board.o;
+	} else {
+		size_t bytes = cells <= 16 ? 2 : cells <= 32 ? 4 : 8;
+		for (size_t i = 0; i < bytes; ++i) {
+			x |= uint64_t(record.board[i]) << (8 * i);
+			o |= uint64_t(record.board[bytes + i]) << (8 * i);
+		}
+	}
+	for (unsigned i = 0; i < cells; ++i) {
+		if (i > 0 && i % record.width == 0)
+			*out++ = '/';
+		*out++ = x >> i & 1 ? 'x' : o >> i & 1 ? 'o' : ' ';
+	}
+	return out;
+}
+
+// writes the records of the log as text, one line each: the seconds since the
+// log started, the event, the player if any, the value, and the board in
+// brackets if any. returns false if the input isn't a log
+bool decode_log(FILE* in, FILE* out)
+{
+	LogHeader header;
+	if (fread(&header, sizeof header, 1, in) != 1 ||
+			memcmp(header.magic, LOG_MAGIC, sizeof header.magic) != 0)
+		return false;
+	fprintf(out, "# started %llu.%09llu\n",
+			(unsigned long long)(header.started / 1000000000),
+			(unsigned long long)(header.started % 1000000000));
+
+	LogRecord record;
+	char line[256];
+	while (fread(&record, sizeof record, 1, in) == 1) {
+		char* end = line + sprintf(line, "%llu.%09llu %s",
+				(unsigned long long)(record.time / 1000000000),
+				(unsigned long long)(record.time % 1000000000),
+				record.event < LOG_EVENTS ? LOG_EVENT_NAMES[record.event] : "unknown");
+		if (record.player) {
+			*end++ = ' ';
+			*end++ = record.player;
+		}
+		*end++ = ' ';
+		end = write_number(end, record.value);
+		if (record.width && record.height && record.width * record.height <= 64) {
+			*end++ = ' ';
+			*end++ = '[';
+			end = write_log_board(end, record);
+			*end++ = ']';
+		}
+		*end++ = '\n';
+		fwrite(line, 1, end - line, out);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,410 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  metrics.hh
+ *
+ *    Description:  Process-wide counters, gauges and latency histograms, exported
+ *                  in the Prometheus text format
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:02:36 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_METRICS
+#define TTT_ENGINE_METRICS
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// metrics are also pushed to Unix sockets where there are any
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TTT_METRICS_SOCKET
+#endif
+
+/* ========== Latency Histogram ========== */
+
+// each power of two of nanoseconds is split into 2^LATENCY_SUB_BITS buckets,
+// so any recorded value is off by at most 1/8 of itself
+#define LATENCY_SUB_BITS 3
+#define LATENCY_BUCKETS (64 << LATENCY_SUB_BITS)
+
+// a log-linear histogram of nanosecond latencies. fixed size, so recording
+// never allocates and histograms merge by adding up the buckets
+struct LatencyHistogram {
+	unsigned long counts[LATENCY_BUCKETS] = {};
+	unsigned long total = 0;
+	uint64_t largest = 0;
+
+	// returns the bucket of the value
+	static unsigned bucket(uint64_t value)
+	{
+		if (value < (1 << LATENCY_SUB_BITS))
+			return value;
+		unsigned exponent = 63 - __builtin_clzll(value);
+		return ((exponent - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) +
+			(value >> (exponent - LATENCY_SUB_BITS) &
+			 ((1 << LATENCY_SUB_BITS) - 1));
+	}
+
+	// returns the smallest value of the bucket
+	static uint64_t bucket_value(unsigned bucket)
+	{
+		if (bucket < (1 << LATENCY_SUB_BITS))
+			return bucket;
+		unsigned exponent = (bucket >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+		return uint64_t((1 << LATENCY_SUB_BITS) +
+				(bucket & ((1 << LATENCY_SUB_BITS) - 1))) <<
+			(exponent - LATENCY_SUB_BITS);
+	}
+
+	void record(uint64_t nanoseconds)
+	{
+		++counts[bucket(nanoseconds)];
+		++total;
+		largest = max(largest, nanoseconds);
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for (unsigned i = 0; i < LATENCY_BUCKETS; ++i)
+			counts[i] += other.counts[i];
+		total += other.total;
+		largest = max(largest, other.largest);
+	}
+
+	// returns the value below which the given fraction of the recorded values
+	// lie, to the precision of the buckets
+	uint64_t percentile(double fraction) const
+	{
+		unsigned long rank = fraction * total, seen = 0;
+		for (unsigned i = 0; i < LATENCY_BUCKETS; ++i) {
+			seen += counts[i];
+			if (seen > rank)
+				return min(bucket_value(i + 1) - 1, largest);
+		}
+		return largest;
+	}
+};
+
+/* ========== Metrics ========== */
+
+// a named metric of the process. every metric adds itself to a list when it
+// is constructed, so that the exporter finds it; metrics are globals that
+// live as long as the program does
+class Metric {
+public:
+	Metric(const char* name, const char* help) : name(name), help(help),
+		next(NULL)
+	{
+		*metrics_tail() = this;
+		metrics_tail() = &next;
+	}
+
+	// writes the metric in the Prometheus text format
+	virtual void write(FILE* out) const = 0;
+
+	// returns the first metric of the list
+	static const Metric* first()
+	{
+		return *head();
+	}
+
+	const Metric* following() const
+	{
+		return next;
+	}
+
+protected:
+	const char* name;
+	const char* help;
+
+private:
+	static Metric** head()
+	{
+		static Metric* first = NULL;
+		return &first;
+	}
+
+	static Metric**& metrics_tail()
+	{
+		static Metric** tail = head();
+		return tail;
+	}
+
+	Metric* next;
+};
+
+// a count that only goes up. recording is a relaxed atomic add
+class Counter : public Metric {
+public:
+	Counter(const char* name, const char* help) : Metric(name, help), value(0)
+	{
+	}
+
+	Counter& operator+=(unsigned long amount)
+	{
+		value.fetch_add(amount, memory_order_relaxed);
+		return *this;
+	}
+
+	Counter& operator++()
+	{
+		return *this += 1;
+	}
+
+	operator unsigned long() const
+	{
+		return value.load(memory_order_relaxed);
+	}
+
+	void write(FILE* out) const
+	{
+		fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %lu\n", name, help,
+				name, name, (unsigned long)*this);
+	}
+
+private:
+	atomic<unsigned long> value;
+};
+
+// a value that goes up and down
+class Gauge : public Metric {
+public:
+	Gauge(const char* name, const char* help) : Metric(name, help), value(0)
+	{
+	}
+
+	void set(long to)
+	{
+		value.store(to, memory_order_relaxed);
+	}
+
+	void add(long amount)
+	{
+		value.fetch_add(amount, memory_order_relaxed);
+	}
+
+	operator long() const
+	{
+		return value.load(memory_order_relaxed);
+	}
+
+	void write(FILE* out) const
+	{
+		fprintf(out, "# HELP %s %s\n# TYPE %s gauge\n%s %ld\n", name, help,
+				name, name, long(*this));
+	}
+
+private:
+	atomic<long> value;
+};
+
+// quantiles given for every latency metric
+const double LATENCY_QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+// the buckets of a LatencyHistogram that any thread may record into at once,
+// exported as a summary in seconds
+class LatencyMetric : public Metric {
+public:
+	LatencyMetric(const char* name, const char* help) : Metric(name, help),
+		sum(0), largest(0)
+	{
+		for (auto& count: counts)
+			count.store(0, memory_order_relaxed);
+	}
+
+	void record(uint64_t nanoseconds)
+	{
+		counts[LatencyHistogram::bucket(nanoseconds)].fetch_add(1,
+				memory_order_relaxed);
+		sum.fetch_add(nanoseconds, memory_order_relaxed);
+		for (uint64_t seen = largest.load(memory_order_relaxed); nanoseconds > seen &&
+				!largest.compare_exchange_weak(seen, nanoseconds,
+					memory_order_relaxed);)
+			;
+	}
+
+	// returns the recorded values so far. buckets recorded into while this
+	// runs may or may not be counted
+	LatencyHistogram snapshot() const
+	{
+		LatencyHistogram histogram;
+		for (unsigned i = 0; i < LATENCY_BUCKETS; ++i) {
+			histogram.counts[i] = counts[i].load(memory_order_relaxed);
+			histogram.total += histogram.counts[i];
+		}
+		histogram.largest = largest.load(memory_order_relaxed);
+		return histogram;
+	}
+
+	void write(FILE* out) const
+	{
+		LatencyHistogram histogram = snapshot();
+		fprintf(out, "# HELP %s %s\n# TYPE %s summary\n", name, help, name);
+		for (double quantile: LATENCY_QUANTILES)
+			fprintf(out, "%s{quantile=\"%g\"} %.9f\n", name, quantile,
+					histogram.percentile(quantile) * 1e-9);
+		fprintf(out, "%s_sum %.9f\n%s_count %lu\n", name,
+				sum.load(memory_order_relaxed) * 1e-9, name, histogram.total);
+	}
+
+private:
+	atomic<unsigned long> counts[LATENCY_BUCKETS];
+	atomic<uint64_t> sum;
+	atomic<uint64_t> largest;
+};
+
+// records the time from its construction to the end of its scope
+class MetricTimer {
+public:
+	explicit MetricTimer(LatencyMetric& metric) : metric(metric),
+		begin(chrono::steady_clock::now())
+	{
+	}
+
+	~MetricTimer()
+	{
+		metric.record(chrono::duration_cast<chrono::nanoseconds>
+				(chrono::steady_clock::now() - begin).count());
+	}
+
+private:
+	LatencyMetric& metric;
+	chrono::steady_clock::time_point begin;
+};
+
+/* ========== Program Metrics ========== */
+
+Counter games_played("ttt_games_total", "Games played to the end");
+Gauge games_active("ttt_games_active", "Games being played");
+LatencyMetric move_latency("ttt_move_decision_seconds",
+		"Time the machine took to choose a move");
+LatencyMetric proto_out_latency("ttt_proto_out_seconds",
+		"Time taken to send a protocol code");
+LatencyMetric proto_query_latency("ttt_proto_query_seconds",
+		"Time from asking a protocol query to its answer");
+LatencyMetric render_latency("ttt_board_render_seconds",
+		"Time taken to present the board");
+
+/* ========== Export ========== */
+
+// writes every metric in the Prometheus text format. prints through stdio,
+// so exporting never counts as a heap allocation of the program
+void metrics_write(FILE* out)
+{
+	for (const Metric* metric = Metric::first(); metric;
+			metric = metric->following())
+		metric->write(out);
+}
+
+// writes every metric to the target, which is either unix:PATH to send them
+// to the Unix socket listening at PATH, or the path of a file. the file is
+// replaced at once by renaming a temporary file over it, so readers never see
+// half of it. returns false if the target couldn't be written
+bool metrics_export(const string& target)
+{
+	FILE* out;
+	string temporary = target + ".tmp";
+	if (target.compare(0, 5, "unix:") == 0) {
+#ifdef TTT_METRICS_SOCKET
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (target.size() - 5 >= sizeof address.sun_path)
+			return false;
+		target.copy(address.sun_path, target.size() - 5, 5);
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return false;
+		if (connect(fd, (sockaddr*)&address, sizeof address) != 0 ||
+				!(out = fdopen(fd, "w"))) {
+			close(fd);
+			return false;
+		}
+		metrics_write(out);
+		return fclose(out) == 0;
+#else
+		return false;
+#endif
+	}
+
+	if (!(out = fopen(temporary.c_str(), "w")))
+		return false;
+	metrics_write(out);
+	if (fclose(out) != 0)
+		return false;
+	return rename(temporary.c_str(), target.c_str()) == 0;
+}
+
+// exports the metrics every interval on a thread of its own once started,
+// and one last time when stopped. the program stops it before it returns,
+// since by the time the exporter is destroyed the metrics defined after it
+// are already gone, so destroying it only ends the thread
+class MetricsExporter {
+public:
+	MetricsExporter() : stopping(false)
+	{
+	}
+
+	~MetricsExporter()
+	{
+		halt();
+	}
+
+	void start(const string& target, chrono::milliseconds interval)
+	{
+		this->target = target;
+		exporter = thread([this, interval] {
+			unique_lock<mutex> guard(lock);
+			while (!wake.wait_for(guard, interval, [this] { return stopping; })) {
+				if (!metrics_export(this->target))
+					cerr << "Cannot export metrics to " << this->target << endl;
+			}
+		});
+	}
+
+	// ends the thread and exports the metrics one last time, if it started
+	void stop()
+	{
+		if (halt() && !metrics_export(target))
+			cerr << "Cannot export metrics to " << target << endl;
+	}
+
+private:
+	// ends the thread. returns false if it wasn't running
+	bool halt()
+	{
+		if (!exporter.joinable())
+			return false;
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_one();
+		exporter.join();
+		return true;
+	}
+
+	string target;
+	thread exporter;
+	mutex lock;
+	condition_variable wake;
+	bool stopping;
+};
+
+MetricsExporter metrics_exporter;
+
+#endif
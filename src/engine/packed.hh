@@ -0,0 +1,227 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  packed.hh
+ *
+ *    Description:  Packed boards: the 2-byte base-3 code of classic boards, the
+ *                  bytes boards travel as, and formatting that never allocates
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:12:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_PACKED
+#define TTT_ENGINE_PACKED
+
+#include <cstddef>
+#include <ostream>
+
+/* ========== Board Indexes ========== */
+
+// number of distinct base-3 board indexes (3^9), so every index fits in 15 bits
+#define BOARD_INDEXES 19683
+
+// base-3 value of each 9-bit mask, i.e. the sum of 3^i for every bit i
+struct Base3Table {
+	unsigned short values[Classic::FULL + 1];
+
+	constexpr Base3Table() : values()
+	{
+		for (unsigned short mask = 0; mask <= Classic::FULL; ++mask) {
+			unsigned short power = 1;
+			for (unsigned short i = 0; i < 9; ++i, power *= 3) {
+				if (mask & (1 << i))
+					values[mask] += power;
+			}
+		}
+	}
+};
+constexpr Base3Table BASE3;
+
+// the x and o masks of the three cells of each three base-3 digits, so that an
+// index decodes a row at a time
+struct TritTable {
+	unsigned char x[27];
+	unsigned char o[27];
+
+	constexpr TritTable() : x(), o()
+	{
+		for (unsigned short digits = 0; digits < 27; ++digits) {
+			unsigned short rest = digits;
+			for (unsigned short i = 0; i < 3; ++i, rest /= 3) {
+				if (rest % 3 == 1)
+					x[digits] |= 1 << i;
+				else if (rest % 3 == 2)
+					o[digits] |= 1 << i;
+			}
+		}
+	}
+};
+constexpr TritTable TRITS;
+
+// returns a compact base-3 index of the board, where ' ' => 0, 'x' => 1, 'o' => 2
+constexpr unsigned short board_index(const ClassicBoard& board)
+{
+	return BASE3.values[board.x] + 2 * BASE3.values[board.o];
+}
+
+// returns the board of the given base-3 index, which must be below
+// BOARD_INDEXES
+constexpr ClassicBoard board_from_index(unsigned short index)
+{
+	return {
+		(unsigned short)(TRITS.x[index % 27] | TRITS.x[index / 27 % 27] << 3 |
+				TRITS.x[index / 729] << 6),
+		(unsigned short)(TRITS.o[index % 27] | TRITS.o[index / 27 % 27] << 3 |
+				TRITS.o[index / 729] << 6)};
+}
+
+// returns whether the index is the index of a board that could come from a
+// real game, as is_reachable judges it
+constexpr bool is_board_index(unsigned short index)
+{
+	return index < BOARD_INDEXES && is_reachable(board_from_index(index));
+}
+
+/* ========== Encoded Boards ========== */
+
+// writes the x mask then the o mask of the board at out, each in as many
+// little-endian bytes as the mask type has, and returns the end of them
+template <class G>
+unsigned char* encode_masks(unsigned char* out, const BitBoard<G>& board)
+{
+	for (size_t i = 0; i < sizeof(typename G::Mask); ++i) {
+		out[i] = board.x >> (8 * i);
+		out[sizeof(typename G::Mask) + i] = board.o >> (8 * i);
+	}
+	return out + 2 * sizeof(typename G::Mask);
+}
+
+// reads masks written by encode_masks. returns false unless the marks could
+// come from a real game
+template <class G>
+bool decode_masks(const unsigned char* in, BitBoard<G>& board)
+{
+	typedef typename G::Mask Mask;
+	board = clean_board<G>();
+	for (size_t i = 0; i < sizeof(Mask); ++i) {
+		board.x |= Mask(in[i]) << (8 * i);
+		board.o |= Mask(in[sizeof(Mask) + i]) << (8 * i);
+	}
+	return !(board.x & board.o) && !((board.x | board.o) & ~G::FULL) &&
+		is_reachable(board);
+}
+
+// returns the bytes a board is encoded in: 2 for the base-3 index of classic
+// boards, or both masks for the others
+template <class G>
+constexpr size_t encoded_size()
+{
+	return 2 * sizeof(typename G::Mask);
+}
+
+template <>
+constexpr size_t encoded_size<Classic>()
+{
+	return 2;
+}
+
+// writes the board in encoded_size bytes at out, and returns the end of them
+template <class G>
+unsigned char* encode_board(unsigned char* out, const BitBoard<G>& board)
+{
+	return encode_masks(out, board);
+}
+
+template <>
+unsigned char* encode_board(unsigned char* out, const ClassicBoard& board)
+{
+	unsigned short index = board_index(board);
+	out[0] = index & 0xff;
+	out[1] = index >> 8;
+	return out + 2;
+}
+
+// reads a board written by encode_board. returns false unless its marks could
+// come from a real game
+template <class G>
+bool decode_board(const unsigned char* in, BitBoard<G>& board)
+{
+	return decode_masks(in, board);
+}
+
+template <>
+bool decode_board(const unsigned char* in, ClassicBoard& board)
+{
+	unsigned short index = in[0] | in[1] << 8;
+	board = board_from_index(index < BOARD_INDEXES ? index : 0);
+	return is_board_index(index);
+}
+
+/* ========== Formatting ========== */
+
+// writes the number at out, and returns the end of it
+char* write_number(char* out, int number)
+{
+	// negated as unsigned, which holds the magnitude of INT_MIN too
+	unsigned magnitude = number;
+	if (number < 0) {
+		*out++ = '-';
+		magnitude = 0u - magnitude;
+	}
+	char digits[12];
+	int count = 0;
+	do {
+		digits[count++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	while (count)
+		*out++ = digits[--count];
+	return out;
+}
+
+// writes the board one char per cell, ' ' for empty, and returns the end of it
+template <class G>
+char* write_board(char* out, const BitBoard<G>& board)
+{
+	for (size_t i = 0; i < G::CELLS; ++i) {
+		typename G::Mask cell = typename G::Mask(1) << i;
+		*out++ = board.x & cell ? 'x' : board.o & cell ? 'o' : ' ';
+	}
+	return out;
+}
+
+// writes a move as fmt_move does, e.g. "mx4", and returns the end of it
+char* write_move(char* out, char player, short index)
+{
+	*out++ = 'm';
+	*out++ = player;
+	return write_number(out, index);
+}
+
+// the cells of a simplified board, printed as they are without building a
+// string
+struct BoardText {
+	const char* cells;
+	size_t size;
+};
+
+template <size_t N>
+BoardText board_text(const array<char, N>& board)
+{
+	return {board.data(), N};
+}
+
+ostream& operator<<(ostream& out, BoardText text)
+{
+	return out.write(text.cells, text.size);
+}
+
+#endif
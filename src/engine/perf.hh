@@ -0,0 +1,213 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  perf.hh
+ *
+ *    Description:  Hardware performance counters around profiled phases
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:47:19 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_PERF
+#define TTT_ENGINE_PERF
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+// the counters come from perf_event_open, so only Linux has them; elsewhere
+// every counter reads as unavailable
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define TTT_PERF_EVENTS
+#endif
+
+/* ========== Events ========== */
+
+// number of events counted
+#define PERF_EVENTS 5
+
+// an event counted around each phase: how it is reported, and how the kernel
+// knows it
+struct PerfEvent {
+	const char* name;
+	uint32_t type;
+	uint64_t config;
+};
+
+#ifdef TTT_PERF_EVENTS
+const PerfEvent PERF_EVENT_LIST[PERF_EVENTS] = {
+	{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{"l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+		PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+	{"llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+		PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+	{"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+#else
+const PerfEvent PERF_EVENT_LIST[PERF_EVENTS] = {
+	{"cycles", 0, 0}, {"instructions", 0, 0}, {"l1d_misses", 0, 0},
+	{"llc_misses", 0, 0}, {"branch_misses", 0, 0},
+};
+#endif
+
+/* ========== Counters ========== */
+
+// the events counted in user space on the thread that opened them. the pool
+// threads of a parallel search are not counted. events the kernel refuses,
+// e.g. under a strict perf_event_paranoid or in a virtual machine without a
+// PMU, are left out and read as unavailable
+class PerfCounters {
+public:
+	PerfCounters()
+	{
+		for (int& fd: fds)
+			fd = -1;
+#ifdef TTT_PERF_EVENTS
+		for (unsigned i = 0; i < PERF_EVENTS; ++i) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof attr);
+			attr.size = sizeof attr;
+			attr.type = PERF_EVENT_LIST[i].type;
+			attr.config = PERF_EVENT_LIST[i].config;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			// more events than hardware counters get time-shared; the times
+			// let the counts be scaled up to the whole phase
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				PERF_FORMAT_TOTAL_TIME_RUNNING;
+			fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+			if (fds[i] < 0 && !failure)
+				failure = strerror(errno);
+		}
+#else
+		failure = "not supported on this platform";
+#endif
+	}
+
+	~PerfCounters()
+	{
+#ifdef TTT_PERF_EVENTS
+		for (int fd: fds) {
+			if (fd >= 0)
+				close(fd);
+		}
+#endif
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// returns whether the event is counted
+	bool available(unsigned event) const
+	{
+		return fds[event] >= 0;
+	}
+
+	// returns why the first event that isn't counted was refused, or NULL if
+	// every event is counted
+	const char* refusal() const
+	{
+		return failure;
+	}
+
+	// returns the count of the event so far, scaled for the time it shared
+	// the hardware, or 0 if it isn't counted
+	uint64_t read_event(unsigned event) const
+	{
+#ifdef TTT_PERF_EVENTS
+		uint64_t values[3];
+		if (fds[event] < 0 || read(fds[event], values, sizeof values) !=
+				sizeof values)
+			return 0;
+		if (values[2] == 0)
+			return 0;
+		if (values[2] == values[1])
+			return values[0];
+		return uint64_t(double(values[0]) * values[1] / values[2]);
+#else
+		return 0;
+#endif
+	}
+
+private:
+	int fds[PERF_EVENTS];
+	const char* failure = NULL;
+};
+
+/* ========== Phases ========== */
+
+// counts of each event when the current phase began, and what each counted
+// from then until the phase stopped
+uint64_t perf_at_begin[PERF_EVENTS];
+uint64_t perf_deltas[PERF_EVENTS];
+
+// returns the counters of the thread that profiles, opened the first time
+PerfCounters& perf_counters()
+{
+	static PerfCounters counters;
+	return counters;
+}
+
+// remembers the counts at the beginning of a phase
+void perf_begin()
+{
+	PerfCounters& counters = perf_counters();
+	for (unsigned i = 0; i < PERF_EVENTS; ++i)
+		perf_at_begin[i] = counters.read_event(i);
+}
+
+// takes what each event counted since perf_begin
+void perf_stop()
+{
+	PerfCounters& counters = perf_counters();
+	for (unsigned i = 0; i < PERF_EVENTS; ++i)
+		perf_deltas[i] = counters.read_event(i) - perf_at_begin[i];
+}
+
+// prints what each event counted in the phase, "n/a" for events that aren't
+// counted, along with instructions per cycle when both are counted. tells
+// once why counters are missing
+void perf_report(ostream& out)
+{
+	PerfCounters& counters = perf_counters();
+	static bool told = false;
+	if (counters.refusal() && !told) {
+		out << "Profiling: some hardware counters are unavailable ("
+			<< counters.refusal() << ")" << endl;
+		told = true;
+	}
+	bool any = false;
+	for (unsigned i = 0; i < PERF_EVENTS; ++i)
+		any = any || counters.available(i);
+	if (!any)
+		return;
+
+	out << "Profiling:";
+	for (unsigned i = 0; i < PERF_EVENTS; ++i) {
+		out << " " << PERF_EVENT_LIST[i].name << "=";
+		if (counters.available(i))
+			out << perf_deltas[i];
+		else
+			out << "n/a";
+	}
+	// hundredths, so the stream keeps its number format
+	if (counters.available(0) && counters.available(1) && perf_deltas[0]) {
+		uint64_t ipc = perf_deltas[1] * 100 / perf_deltas[0];
+		out << " ipc=" << ipc / 100 << "." << ipc / 10 % 10 << ipc % 10;
+	}
+	out << endl;
+}
+
+#endif
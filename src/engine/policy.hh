@@ -0,0 +1,171 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  policy.hh
+ *
+ *    Description:  Compile-time solved policy for the classic 3x3 game
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:20:37 AM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_POLICY
+#define TTT_ENGINE_POLICY
+
+/* ========== Solved Policy ========== */
+
+// returns whether the solved policy needs to cover the position: it is
+// canonical, the game is not over, and it can be reached in a real game
+constexpr bool is_policy_position(unsigned short index)
+{
+	ClassicBoard board = board_from_index(index);
+	int marks_ahead = cell_count(board.x) - cell_count(board.o);
+	return (marks_ahead == 0 || marks_ahead == 1) &&
+		board_winner(board) == ' ' && !is_full(board) &&
+		canonical_board(board) == board;
+}
+
+// returns the number of positions the solved policy covers
+constexpr unsigned short count_policy_positions()
+{
+	unsigned short count = 0;
+	for (unsigned short index = 0; index < BOARD_INDEXES; ++index) {
+		if (is_policy_position(index))
+			++count;
+	}
+	return count;
+}
+constexpr unsigned short POLICY_POSITIONS = count_policy_positions();
+
+// The whole 3x3 game solved at compile time. Holds one entry per canonical
+// position, sorted by index: the best moves of the player to move as a cell
+// mask of the canonical board, and that player's score normalized to depth 0,
+// i.e. 10 - plies for a win in that many plies and plies - 10 for a loss,
+// which is what minimax_internal would return with the node at depth 0. the
+// score of each move, by cell of the canonical board, is on the same scale.
+struct PolicyTable {
+	unsigned short indexes[POLICY_POSITIONS];
+	unsigned short best_moves[POLICY_POSITIONS];
+	signed char values[POLICY_POSITIONS];
+	signed char move_values[POLICY_POSITIONS][9];
+
+	constexpr PolicyTable() : indexes(), best_moves(), values(), move_values()
+	{
+		// every position is solved first; placing a mark only ever increases
+		// the index, so walking downwards solves every child before its parent
+		signed char solved_values[BOARD_INDEXES] = {};
+		unsigned short solved_moves[BOARD_INDEXES] = {};
+		for (unsigned short index = BOARD_INDEXES; index-- > 0;) {
+			ClassicBoard board = board_from_index(index);
+
+			bool x_to_move = to_move(board) == 'x';
+			char winner = board_winner(board);
+			if (winner != ' ') {
+				solved_values[index] = (winner == 'x') == x_to_move ?
+					Classic::WIN : -Classic::WIN;
+				continue;
+			}
+			if (is_full(board))
+				continue;
+
+			int best = -128;
+			unsigned short power = 1;
+			for (unsigned short i = 0; i < 9; ++i, power *= 3) {
+				if (!(empty_mask(board) & (1 << i)))
+					continue;
+				int child = solved_values[index + power * (x_to_move ? 1 : 2)];
+				// negate for the other player, one ply further from the end
+				int value = child > 0 ? 1 - child : child < 0 ? -1 - child : 0;
+				if (value > best) {
+					best = value;
+					solved_moves[index] = 1 << i;
+				} else if (value == best) {
+					solved_moves[index] |= 1 << i;
+				}
+			}
+			solved_values[index] = best;
+		}
+
+		unsigned short entry = 0;
+		for (unsigned short index = 0; index < BOARD_INDEXES; ++index) {
+			if (!is_policy_position(index))
+				continue;
+			indexes[entry] = index;
+			best_moves[entry] = solved_moves[index];
+			values[entry] = solved_values[index];
+			ClassicBoard board = board_from_index(index);
+			unsigned short power = 1;
+			for (unsigned short i = 0; i < 9; ++i, power *= 3) {
+				if (!(empty_mask(board) & (1 << i)))
+					continue;
+				int child = solved_values[index +
+					power * (to_move(board) == 'x' ? 1 : 2)];
+				move_values[entry][i] =
+					child > 0 ? 1 - child : child < 0 ? -1 - child : 0;
+			}
+			++entry;
+		}
+	}
+};
+constexpr PolicyTable POLICY;
+
+// returns the policy entry of the canonical form of a reachable board where
+// the game is not over
+size_t policy_entry(const ClassicBoard& canonical)
+{
+	return lower_bound(POLICY.indexes, POLICY.indexes + POLICY_POSITIONS,
+			board_index(canonical)) - POLICY.indexes;
+}
+
+// returns desired move for the player to move, or -1 if game over. searches
+// the position within the limits, except on the classic board, which has its
+// own overload
+template <class G>
+short minimax(const BitBoard<G>& board, SearchLimits& limits)
+{
+	return minimax_deepening(board, limits);
+}
+
+// returns desired move for the player to move, or -1 if game over. picks a
+// random move among the equally good ones in the solved policy, unless built
+// with COMPILE_SEARCH. leaves them, their score and the score of every move in
+// the result of the limits
+short minimax(const ClassicBoard& board, SearchLimits& limits)
+{
+#ifdef COMPILE_SEARCH
+	return minimax_deepening(board, limits);
+#else
+	SearchResult& result = limits.result;
+	result = SearchResult();
+	result.depth_reached = cell_count(empty_mask(board));
+	result.exact = true;
+	if (board_winner(board) != ' ' ||
+			is_full(board))
+		return -1;
+
+	// look up the canonical form, then map its moves back onto this board
+	unsigned short transform = canonical_transform(board);
+	size_t entry = policy_entry(transform_board(board, transform));
+	result.best_moves = transform_mask<Classic>(POLICY.best_moves[entry],
+			INVERSE_SYMMETRIES[transform]);
+	result.score = POLICY.values[entry];
+
+	// the canonical board's move scores, mapped back onto this board
+	result.scored_moves = empty_mask(board);
+	for (unsigned short moves = result.scored_moves; moves; moves &= moves - 1) {
+		unsigned short move = lowest_cell(moves);
+		result.scores[move] = POLICY.move_values[entry][lowest_cell(
+				transform_mask<Classic>(1 << move, transform))];
+	}
+	return random_cell(result.best_moves, limits.random);
+#endif
+}
+
+#endif
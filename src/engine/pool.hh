@@ -0,0 +1,148 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pool.hh
+ *
+ *    Description:  Fixed-size thread pool running batches of search tasks
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 02:05:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_POOL
+#define TTT_ENGINE_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* ========== Thread Pool ========== */
+
+// A pool of threads that are started once and then reused for every batch.
+// A batch is a number of tasks, 0 to count - 1, that the pool threads and the
+// thread calling run() take one by one until none are left. One batch runs at
+// a time; run() waits for the previous one to finish.
+class ThreadPool {
+public:
+	// threads counts the calling thread, so a pool of 1 runs everything inline
+	explicit ThreadPool(unsigned threads) : current(NULL), call(NULL), total(0),
+		finished(0), active(0), next(0), batch(0), stopping(false)
+	{
+		for (unsigned i = 1; i < threads; ++i)
+			workers.emplace_back(&ThreadPool::work, this);
+	}
+
+	~ThreadPool()
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker: workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// number of threads working on a batch, the calling one included
+	unsigned size() const
+	{
+		return workers.size() + 1;
+	}
+
+	// runs task(i) for every i below count, and returns once all are done.
+	// the task is called through a plain function pointer rather than a
+	// std::function, which could allocate
+	template <class Task>
+	void run(size_t count, Task& task)
+	{
+		lock_guard<mutex> one_batch(running);
+		if (workers.empty() || count <= 1) {
+			for (size_t i = 0; i < count; ++i)
+				task(i);
+			return;
+		}
+
+		{
+			// a pool thread that woke too late for the last batch may still be
+			// looking at it
+			unique_lock<mutex> guard(lock);
+			done.wait(guard, [this] { return active == 0; });
+			current = &task;
+			call = [](void* task, size_t i) { (*static_cast<Task*>(task))(i); };
+			total = count;
+			next = 0;
+			finished = 0;
+			++batch;
+		}
+		wake.notify_all();
+		size_t ran = take_tasks();
+
+		unique_lock<mutex> guard(lock);
+		finished += ran;
+		done.wait(guard, [this] { return finished == total && active == 0; });
+		current = NULL;
+	}
+
+private:
+	// the loop of each pool thread: sleeps until a new batch comes, then helps
+	// with it
+	void work()
+	{
+		unsigned long seen = 0;
+		for (;;) {
+			{
+				unique_lock<mutex> guard(lock);
+				wake.wait(guard, [&] { return stopping || batch != seen; });
+				if (stopping)
+					return;
+				seen = batch;
+				++active;
+			}
+			size_t ran = take_tasks();
+
+			lock_guard<mutex> guard(lock);
+			finished += ran;
+			--active;
+			done.notify_all();
+		}
+	}
+
+	// runs tasks of the current batch until none are left to take, and
+	// returns how many it ran
+	size_t take_tasks()
+	{
+		size_t ran = 0;
+		for (size_t i; (i = next.fetch_add(1)) < total; ++ran)
+			call(current, i);
+		return ran;
+	}
+
+	vector<thread> workers;
+	mutex running;
+	mutex lock;
+	condition_variable wake, done;
+
+	// the current batch, guarded by lock except for next. active counts the
+	// pool threads looking at it; no new batch starts before they are done
+	void* current;
+	void (*call)(void*, size_t);
+	size_t total, finished;
+	unsigned active;
+	atomic<size_t> next;
+	unsigned long batch;
+	bool stopping;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  random.hh
+ *
+ *    Description:  Small, fast random number generator for tie-breaking
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:58:20 PM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_RANDOM
+#define TTT_ENGINE_RANDOM
+
+#include <cstdint>
+
+/* ========== Generator ========== */
+
+// xoshiro256**: 32 bytes of state and a handful of instructions per number.
+// each search owns one, so threads never share random state, and the same
+// seed always gives the same numbers
+struct Random {
+	typedef uint64_t result_type;
+
+	explicit Random(uint64_t seed = 0)
+	{
+		// splitmix64 spreads the seed over the state, which must not be all zero
+		for (auto& word: state) {
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t mixed = seed;
+			mixed = (mixed ^ mixed >> 30) * 0xbf58476d1ce4e5b9ULL;
+			mixed = (mixed ^ mixed >> 27) * 0x94d049bb133111ebULL;
+			word = mixed ^ mixed >> 31;
+		}
+	}
+
+	uint64_t operator()()
+	{
+		uint64_t output = rotate(state[1] * 5, 7) * 9;
+		uint64_t shifted = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= shifted;
+		state[3] = rotate(state[3], 45);
+		return output;
+	}
+
+	static constexpr uint64_t min() { return 0; }
+	static constexpr uint64_t max() { return UINT64_MAX; }
+
+	// returns a number below range (which must not be 0), every one equally
+	// likely. Lemire's multiply-and-shift, redrawing only the few numbers that
+	// would make the low results more likely; needs no division in most calls
+	uint32_t below(uint32_t range)
+	{
+		uint64_t product = uint64_t(uint32_t((*this)() >> 32)) * range;
+		uint32_t low = uint32_t(product);
+		if (low < range) {
+			uint32_t threshold = uint32_t(-range) % range;
+			while (low < threshold) {
+				product = uint64_t(uint32_t((*this)() >> 32)) * range;
+				low = uint32_t(product);
+			}
+		}
+		return product >> 32;
+	}
+
+	// reservoir sampling of one item out of a stream: call with the number of
+	// items seen so far, the current one included; keep the current item when
+	// it returns true. every item of the stream ends up kept equally likely
+	bool keep(uint32_t seen)
+	{
+		return below(seen) == 0;
+	}
+
+private:
+	static uint64_t rotate(uint64_t value, int bits)
+	{
+		return value << bits | value >> (64 - bits);
+	}
+
+	uint64_t state[4];
+};
+
+#endif
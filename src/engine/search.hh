@@ -0,0 +1,546 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  search.hh
+ *
+ *    Description:  Alpha-beta minimax search for m,n,k games
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:48:03 AM
+ *       Revision:  none
+ *       Compiler:  gcc/clang
+ *
+ *         Author:  Michael Peng
+ *   Organization:  A.E. Kent Middle School
+ *
+ * =====================================================================================
+ */
+
+#ifndef TTT_ENGINE_SEARCH
+#define TTT_ENGINE_SEARCH
+
+/* ========== Transposition Table ========== */
+
+// kinds of stored scores: exact, or a lower/upper bound found by a cut-off search
+#define TT_EXACT 1
+#define TT_LOWER 2
+#define TT_UPPER 3
+
+// a searched position: the kind of score (0 for an empty entry), how many plies
+// were searched below it (TT_SOLVED when the score never relied on estimates),
+// and the score from the view of the player to move, normalized to depth 0.
+// these are packed into the data word, which is stored next to the key of the
+// canonical board xor'ed with it, so that threads share the table without
+// locks: an entry torn by two threads writing at once fails the key check and
+// reads as a miss
+#define TT_SOLVED 255
+struct TTEntry {
+	atomic<uint64_t> check;
+	atomic<uint64_t> data;
+};
+
+// number of entries per table, as a power of two
+template <class G>
+constexpr unsigned TT_BITS = G::CELLS <= 9 ? 14 : 20;
+
+// one table per geometry. the tables are never cleared, so they persist
+// across moves and across games.
+template <class G>
+TTEntry tt_table[1 << TT_BITS<G>];
+
+// empties the table of the geometry
+template <class G>
+void tt_clear()
+{
+	for (TTEntry& entry: tt_table<G>) {
+		entry.check.store(0, memory_order_relaxed);
+		entry.data.store(0, memory_order_relaxed);
+	}
+}
+
+// returns the key of the canonical board: the board itself when it fits in 64
+// bits, otherwise a hash of it
+template <class G>
+inline uint64_t tt_key(const BitBoard<G>& board)
+{
+	if (G::CELLS <= 32)
+		return uint64_t(board.x) | uint64_t(board.o) << 32;
+	uint64_t hash = uint64_t(board.x) * 0x9e3779b97f4a7c15ULL;
+	hash = (hash ^ hash >> 31 ^ uint64_t(board.o)) * 0xc2b2ae3d27d4eb4fULL;
+	return hash ^ hash >> 29;
+}
+
+// returns the table slot of the key
+template <class G>
+inline size_t tt_slot(uint64_t key)
+{
+	return (key * 0x9e3779b97f4a7c15ULL) >> (64 - TT_BITS<G>);
+}
+
+// looks up the canonical board; returns true and writes the score adjusted to
+// the given depth if it was searched at least draft plies deep and is known
+// well enough to settle the alpha-beta window. solved_out tells whether the
+// score is exact regardless of depth
+template <class G>
+bool tt_probe(const BitBoard<G>& board, unsigned short depth, unsigned short draft,
+		int alpha, int beta, int& score_out, bool& solved_out)
+{
+	uint64_t key = tt_key(board);
+	const TTEntry& entry = tt_table<G>[tt_slot<G>(key)];
+	uint64_t data = entry.data.load(memory_order_relaxed);
+	if ((entry.check.load(memory_order_relaxed) ^ data) != key)
+		return false;
+
+	signed char stored = data & 0xff;
+	unsigned char kind = data >> 8 & 0xff;
+	unsigned char stored_draft = data >> 16 & 0xff;
+	if (kind == 0 || stored_draft < draft)
+		return false;
+	// wins and losses get closer to 0 the deeper they are found
+	int score = stored > 0 ? stored - depth :
+	            stored < 0 ? stored + depth : 0;
+	if ((kind == TT_LOWER && score < beta) ||
+			(kind == TT_UPPER && score > alpha))
+		return false;
+	score_out = score;
+	solved_out = stored_draft == TT_SOLVED;
+	return true;
+}
+
+// records the score of the canonical board found at the given depth
+template <class G>
+void tt_store(const BitBoard<G>& board, unsigned short depth, unsigned char draft,
+		int score, unsigned char kind)
+{
+	uint64_t key = tt_key(board);
+	TTEntry& entry = tt_table<G>[tt_slot<G>(key)];
+	signed char stored = score > 0 ? score + depth :
+	                     score < 0 ? score - depth : 0;
+	uint64_t data = uint64_t((unsigned char)stored) | uint64_t(kind) << 8 |
+		uint64_t(draft) << 16;
+	entry.check.store(key ^ data, memory_order_relaxed);
+	entry.data.store(data, memory_order_relaxed);
+}
+
+/* ========== Search ========== */
+
+// beyond any reachable score, used as the initial alpha-beta window
+#define SCORE_INF 1000
+
+// how often, in nodes, each thread checks the deadline and node budget
+#define DEADLINE_CHECK_NODES 1024
+
+// lifetime counts over every search, added to once per searching thread
+Counter search_nodes("ttt_search_nodes_total", "Positions visited by searches");
+Counter tt_hits("ttt_tt_hits_total", "Transposition table lookups that hit");
+Counter tt_misses("ttt_tt_misses_total", "Transposition table lookups that missed");
+
+// the most cells a board may have: one bit each in a mask of 64 bits
+#define MAX_CELLS 64
+
+// what a search found, and what finding it took
+struct SearchResult {
+	SearchResult() : move(-1), score(0), best_moves(0), scored_moves(0),
+		scores(), depth_reached(0), exact(false), nodes(0), leaves(0),
+		max_depth(0), tt_hits(0), tt_probes(0), elapsed_ns(0)
+	{
+	}
+
+	// the move chosen (-1 if none) and the mask of every move with the best
+	// score, which is from the view of the player to move
+	short move;
+	int score;
+	uint64_t best_moves;
+
+	// the score of every move in scored_moves, by cell. moves that can't beat
+	// the best hold an upper bound rather than their exact score
+	uint64_t scored_moves;
+	int scores[MAX_CELLS];
+
+	// the deepest iteration that completed, and whether it solved the game
+	unsigned short depth_reached;
+	bool exact;
+
+	// positions visited, of which leaves were scored without searching further
+	// (game over or estimated), the deepest ply visited, the transposition table
+	// lookups and how many of them hit, and the time the move took
+	unsigned long nodes, leaves;
+	unsigned short max_depth;
+	unsigned long tt_hits, tt_probes;
+	uint64_t elapsed_ns;
+};
+
+// limits of one search, shared by every thread searching it, and what the
+// search found out about them
+struct SearchLimits {
+	// limits that let the search run until the game is solved
+	explicit SearchLimits(uint64_t seed = 0) :
+		deadline(chrono::steady_clock::time_point::max()), node_budget(0),
+		horizon(0), parallel(true), nodes(0), estimates(0), leaves(0),
+		tt_hits(0), tt_probes(0), max_depth(0), aborted(false), random(seed)
+	{
+	}
+
+	// limits that stop the search after the given time or nodes (0 for no limit)
+	SearchLimits(long milliseconds, unsigned long node_budget, uint64_t seed) :
+		SearchLimits(seed)
+	{
+		if (milliseconds > 0)
+			deadline = chrono::steady_clock::now() +
+				chrono::milliseconds(milliseconds);
+		this->node_budget = node_budget;
+	}
+
+	// the search gives up past the deadline or after about node_budget nodes
+	// (0 for no budget); the first ply is always searched regardless
+	chrono::steady_clock::time_point deadline;
+	unsigned long node_budget;
+
+	// positions this many plies from the root are estimated, not searched
+	unsigned short horizon;
+
+	// whether the root moves are split across the search pool; off for
+	// searches that already run on a pool thread
+	bool parallel;
+
+	// counted by every thread as it searches, over every iteration
+	atomic<unsigned long> nodes;
+	atomic<unsigned long> estimates;
+	atomic<unsigned long> leaves;
+	atomic<unsigned long> tt_hits, tt_probes;
+	atomic<unsigned short> max_depth;
+	atomic<bool> aborted;
+
+	// filled in by the thread that started the search; the counts above are
+	// copied in by finish_result
+	SearchResult result;
+
+	// breaks ties between equally good moves. only the thread that started
+	// the search uses it
+	Random random;
+};
+
+// copies the counts of the search into its result, along with the chosen move
+// and the time since begin
+void finish_result(SearchLimits& limits, short move,
+		chrono::steady_clock::time_point begin)
+{
+	SearchResult& result = limits.result;
+	result.move = move;
+	result.nodes = limits.nodes;
+	result.leaves = limits.leaves;
+	result.max_depth = limits.max_depth;
+	result.tt_hits = limits.tt_hits;
+	result.tt_probes = limits.tt_probes;
+	result.elapsed_ns = chrono::duration_cast<chrono::nanoseconds>
+		(chrono::steady_clock::now() - begin).count();
+}
+
+// what one thread counts while it searches part of the tree, kept apart from
+// the other threads until it is done
+struct SearchWorker {
+	explicit SearchWorker(SearchLimits& limits) : limits(limits), nodes(0),
+		estimates(0), leaves(0), tt_hits(0), tt_misses(0), max_depth(0)
+	{
+	}
+
+	// adds the counts to the search and lifetime totals
+	~SearchWorker()
+	{
+		limits.nodes += nodes % DEADLINE_CHECK_NODES;
+		limits.estimates += estimates;
+		limits.leaves += leaves;
+		limits.tt_hits += tt_hits;
+		limits.tt_probes += tt_hits + tt_misses;
+		for (unsigned short seen = limits.max_depth; max_depth > seen &&
+				!limits.max_depth.compare_exchange_weak(seen, max_depth);)
+			;
+		search_nodes += nodes;
+		::tt_hits += tt_hits;
+		::tt_misses += tt_misses;
+	}
+
+	SearchLimits& limits;
+	unsigned long nodes;
+	unsigned long estimates;
+	unsigned long leaves;
+	unsigned long tt_hits, tt_misses;
+	unsigned short max_depth;
+};
+
+// returns whether the search has used up its time or nodes. the nodes of all
+// threads are added up every DEADLINE_CHECK_NODES nodes of each
+bool out_of_budget(SearchWorker& worker)
+{
+	SearchLimits& limits = worker.limits;
+	if (worker.nodes % DEADLINE_CHECK_NODES != 0)
+		return false;
+	unsigned long nodes = limits.nodes += DEADLINE_CHECK_NODES;
+	return limits.horizon > 1 && ((limits.node_budget && nodes >= limits.node_budget) ||
+		chrono::steady_clock::now() >= limits.deadline);
+}
+
+// estimates the position for the player to move when the search stops at the
+// horizon: marks in lines still open to the player, minus those in lines
+// still open to the opponent. kept within limit, below any win the search
+// could find, so that estimates never pass for real results
+template <class G>
+int estimate(const BitBoard<G>& board, int limit)
+{
+	typename G::Mask own = to_move(board) == 'x' ? board.x : board.o;
+	typename G::Mask other = to_move(board) == 'x' ? board.o : board.x;
+	int output = 0;
+	for (auto win_mask: WIN_LINES<G>.masks) {
+		if (!(win_mask & other))
+			output += cell_count(win_mask & own);
+		if (!(win_mask & own))
+			output -= cell_count(win_mask & other);
+	}
+	limit = max(limit, 0);
+	return min(max(output, -limit), limit);
+}
+
+// the internal function of MiniMax, called recursively. a negamax alpha-beta
+// search from the view of the player to move, on a board nobody has won yet.
+// scores are G::WIN - depth for a win found at that depth, the negation of
+// that for a loss, and 0 for a draw; positions at the horizon get an estimate
+// instead. returns the exact score when it lies strictly between alpha and
+// beta, otherwise a bound on it past the window (fail-soft). returns 0 once
+// the search is aborted.
+template <class G>
+int minimax_internal(const BitBoard<G>& board, unsigned short depth,
+		int alpha, int beta, SearchWorker& worker)
+{
+	typedef typename G::Mask Mask;
+	SearchLimits& limits = worker.limits;
+	++worker.nodes;
+	worker.max_depth = max(worker.max_depth, depth);
+	if (limits.aborted.load(memory_order_relaxed) || out_of_budget(worker)) {
+		limits.aborted = true;
+		return 0;
+	}
+
+	Mask empties = empty_mask(board);
+	if (!empties) {
+		++worker.leaves;
+		return 0;
+	}
+
+	char player = to_move(board);
+	Mask own = player == 'x' ? board.x : board.o;
+	Mask other = player == 'x' ? board.o : board.x;
+
+	// nothing beats winning right away
+	if (winning_cells<G>(own, empties)) {
+		++worker.leaves;
+		return G::WIN - (depth+1);
+	}
+
+	if (depth >= limits.horizon) {
+		++worker.leaves;
+		++worker.estimates;
+		return estimate(board, G::WIN - limits.horizon - 2);
+	}
+
+	BitBoard<G> canonical = canonical_board(board);
+	unsigned short draft = limits.horizon - depth;
+	int best;
+	bool solved;
+	if (tt_probe(canonical, depth, draft, alpha, beta, best, solved)) {
+		++worker.tt_hits;
+		// a score that relied on estimates makes this one rely on them too
+		if (!solved)
+			++worker.estimates;
+		return best;
+	}
+	++worker.tt_misses;
+
+	// every move but a block of the opponent's line loses at once, so only the
+	// blocks need searching when there are any
+	Mask blocks = winning_cells<G>(other, empties);
+	unsigned groups = blocks ? 1 : OrderTable<G>::GROUPS;
+
+	int alpha_in = alpha;
+	unsigned long estimates_in = worker.estimates;
+	best = -SCORE_INF;
+	BitBoard<G> hypo_board;
+	for (unsigned g = 0; g < groups; ++g) {
+		Mask group = blocks ? blocks : MOVE_ORDER<G>.groups[g] & empties;
+		for (; group; group &= group - 1) {
+			hypo_board = board;
+			place(hypo_board, player, lowest_cell(group));
+
+			int child = -minimax_internal(hypo_board, depth+1, -beta, -alpha, worker);
+			if (limits.aborted)
+				return 0;
+			best = max(best, child);
+			alpha = max(alpha, best);
+			// the other player would never let the game get here
+			if (alpha >= beta)
+				goto cut_off;
+		}
+	}
+cut_off:
+
+	tt_store(canonical, depth,
+		worker.estimates == estimates_in ? TT_SOLVED : min<int>(draft, 254), best,
+		best <= alpha_in ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT);
+	return best;
+}
+
+// number of threads searching, 0 for one per hardware thread. only read when
+// the first search starts
+unsigned search_threads = 0;
+
+Gauge pool_threads("ttt_search_threads", "Threads of the search pool");
+
+// returns the threads the search pool has, or will have once it starts
+unsigned search_thread_count()
+{
+	return search_threads ? search_threads : max(thread::hardware_concurrency(), 1u);
+}
+
+// returns the pool the root moves are searched on
+ThreadPool& search_pool()
+{
+	static ThreadPool pool(search_thread_count());
+	pool_threads.set(pool.size());
+	return pool;
+}
+
+// searches every move for the player to move within the limits, and returns
+// one of the best at random, or -1 if game over or the search was aborted.
+// the moves are searched in parallel on the search pool, the hinted move (if
+// not -1) first. the best moves and the score of each move are left in the
+// result of the limits unless aborted.
+// simplified version of minimax_internal
+template <class G>
+short minimax_root(const BitBoard<G>& board, SearchLimits& limits, short hint)
+{
+	typedef typename G::Mask Mask;
+	if (board_winner(board) != ' ' ||
+			is_full(board))
+		return -1;
+
+	char player = to_move(board);
+	Mask empties = empty_mask(board);
+	// nothing beats winning right away
+	Mask wins = winning_cells<G>(player == 'x' ? board.x : board.o, empties);
+	SearchResult& result = limits.result;
+	if (wins) {
+		result.best_moves = result.scored_moves = wins;
+		result.score = G::WIN - 1;
+		for (Mask win = wins; win; win &= win - 1)
+			result.scores[lowest_cell(win)] = G::WIN - 1;
+		return random_cell(wins, limits.random);
+	}
+	Mask first = hint < 0 ? 0 : (Mask(1) << hint) & empties;
+
+	FixedVector<short, G::CELLS> moves;
+	FixedVector<int, G::CELLS> scores;
+	// canonical forms of the resulting boards; moves that give symmetric
+	// boards share one search, that of the move at index shared_with
+	FixedVector<BitBoard<G>, G::CELLS> canonicals;
+	FixedVector<unsigned char, G::CELLS> shared_with;
+	// indexes of the moves that get a search of their own
+	FixedVector<unsigned char, G::CELLS> searched;
+	// the hint, then everything else in search order
+	for (unsigned g = 0; g <= OrderTable<G>::GROUPS; ++g) {
+		Mask group = g == 0 ? first : MOVE_ORDER<G>.groups[g-1] & empties & ~first;
+		for (; group; group &= group - 1) {
+			short _move = lowest_cell(group);
+			BitBoard<G> hypo_board = board;
+			place(hypo_board, player, _move);
+
+			BitBoard<G> canonical = canonical_board(hypo_board);
+			size_t seen = find(canonicals.begin(), canonicals.end(), canonical)
+				- canonicals.begin();
+			if (seen == canonicals.size())
+				searched.push_back(moves.size());
+			moves.push_back(_move);
+			scores.push_back(-SCORE_INF);
+			canonicals.push_back(canonical);
+			shared_with.push_back(seen);
+		}
+	}
+
+	// the best exact score so far. only moves that tie it need an exact score,
+	// so the others may fail low; it only ever grows, so a move that failed
+	// low still loses to the best once every move is searched
+	atomic<int> best(-SCORE_INF);
+	auto search_move = [&](size_t task) {
+		size_t index = searched[task];
+		BitBoard<G> hypo_board = board;
+		place(hypo_board, player, moves[index]);
+		int score;
+		{
+			SearchWorker worker(limits);
+			score = -minimax_internal(hypo_board, 1, -SCORE_INF,
+					1 - best.load(), worker);
+		}
+		scores[index] = score;
+		for (int seen = best.load();
+				score > seen && !best.compare_exchange_weak(seen, score);)
+			;
+	};
+	if (limits.parallel) {
+		search_pool().run(searched.size(), search_move);
+	} else {
+		for (size_t task = 0; task < searched.size(); ++task)
+			search_move(task);
+	}
+	if (limits.aborted)
+		return -1;
+
+	result.best_moves = result.scored_moves = 0;
+	result.score = best;
+	for (size_t i = 0; i < moves.size(); ++i) {
+		scores[i] = scores[shared_with[i]];
+		result.scores[moves[i]] = scores[i];
+		result.scored_moves |= uint64_t(1) << moves[i];
+		if (scores[i] == best)
+			result.best_moves |= uint64_t(1) << moves[i];
+	}
+	return moves[rand_max_index(scores, limits.random)];
+}
+
+// iterative deepening: searches 1, 2, 3... plies deep until the result is
+// exact or the limits run out, and returns the best move of the deepest search
+// that completed, or -1 if game over. the depth reached and whether the move
+// is exact are left in the result of the limits
+template <class G>
+short minimax_deepening(const BitBoard<G>& board, SearchLimits& limits)
+{
+	short move = -1;
+	SearchResult& result = limits.result;
+	result = SearchResult();
+	for (unsigned short horizon = 1; horizon <= cell_count(empty_mask(board));
+			++horizon) {
+		limits.horizon = horizon;
+		limits.estimates = 0;
+		short found = minimax_root(board, limits, move);
+		if (limits.aborted)
+			break;
+
+		move = found;
+		result.depth_reached = horizon;
+		// nothing was estimated, so searching deeper can't change anything
+		if (limits.estimates == 0) {
+			result.exact = true;
+			break;
+		}
+	}
+	return move;
+}
+
+// the external function of the minimax search, returns desired move for the
+// player to move, or -1 if game over. searches until the game is solved
+template <class G>
+short minimax_search(const BitBoard<G>& board)
+{
+	SearchLimits limits;
+	limits.horizon = G::CELLS;
+	return minimax_root(board, limits, -1);
+}
+
+#endif
@@ -15,6 +15,9 @@
  *
  * =====================================================================================
  */
+// needs C++14 or newer (g++ -std=c++14): the line, index and symmetry tables
+// are computed by constexpr functions with loops, and held in variable
+// templates such as WIN_LINES<G>
 #include <stdlib.h>
 #include <iostream>
 #include <string>
@@ -25,6 +28,8 @@
 #include <limits>
 #include <fstream>
 #include <chrono>
+#include <iomanip>
+#include <new>
 #include "termcolor.hpp"
 // sleep is used later
 #if defined(__linux__) || defined(__APPLE__)
@@ -40,142 +45,83 @@
 
 #endif
 
-// debug setup
+// debug setup. debug builds write the event log there unless --log says
+// otherwise; read it with --decode-log
 //#define TTT_DEBUG
-#define DEBUG_FNAME "/tmp/ttt-debug.log"
+#define DEBUG_FNAME "/tmp/ttt-debug.tttlog"
 
 using namespace std;
 
 /* ========== Debug Routines ========== */
 
 #ifdef TTT_DEBUG
-
 #pragma message "Tic Tac Toe Debug is enabled"
-fstream debug_file;
-
-void debug_init()
-{
-	debug_file.open(DEBUG_FNAME, iostream::out);
-}
-
-void debug_write(const string& msg)
-{
-	debug_file << msg << endl;
-}
-
-void debug_exit()
-{
-	debug_file.close();
-}
-
-#else
-
-#define debug_init()
-#define debug_write(m)
-#define debug_exit()
-
-class NullBuffer : public streambuf {
-	public:
-		int overflow(int c) {
-			return c;
-		}
-};
-
-NullBuffer debug_nbuff;
-ostream debug_file(&debug_nbuff);
-
 #endif
 
 /* ========== Global Variables, Typedefs ========== */
 
-// the role of the machine
-char machine = ' ';
-
-// simplified board
-typedef array<char, 9> Board;
+// simplified board, used for input/output
+template <class G>
+using Board = array<char, G::CELLS>;
 
 /* ========== Board Manipulation ========== */
 
-// deduces the winner of the board.
-// return values: 'o', 'x', or ' ' for no winner
-// following function is defined later
-string board_to_string(const Board& board);
-char board_winner(const Board& board)
-{
-	// winning patterns
-	const short WIN_PTNS[8][3] = {
-		// horizontals
-		{0, 1, 2},
-		{3, 4, 5},
-		{6, 7, 8},
-
-		// verticals
-		{0, 3, 6},
-		{1, 4, 7},
-		{2, 5, 8},
-
-		// diagonals
-		{0, 4, 8},
-		{2, 4, 6}
-	};
-
-	for (auto& win_ptn: WIN_PTNS) {
-		// check if all cells referenced from this array are equal in value
-		// previous bug: prematurely returned ' ' from loop
-		char first_cell = board[win_ptn[0]];
-		if (first_cell != ' ' &&
-				board[win_ptn[1]] == first_cell &&
-				board[win_ptn[2]] == first_cell) {
-			return first_cell;
-		}
-	}
-
-	// No winners found - could be completely full, could be partly occupied
-	return ' ';
-}
+#include "engine/board.hh"
+#include "engine/packed.hh"
 
-// returns a vector of board indexes that point to empty cells.
-vector<short> empty_cells(const Board& board)
+// returns a bitboard with the same cells as the simplified board
+template <class G>
+BitBoard<G> to_bitboard(const Board<G>& board)
 {
-	vector<short> output;
-	for (size_t i = 0; i < 9; ++i) {
-		if (board[i] == ' ')
-			output.push_back(i);
+	BitBoard<G> output = clean_board<G>();
+	for (size_t i = 0; i < G::CELLS; ++i) {
+		if (board[i] == 'x' || board[i] == 'o')
+			place(output, board[i], i);
 	}
 	return output;
 }
 
-// returns a completely sanitary board for new games.
-Board clean_board()
+#include "engine/eventlog.hh"
+
+// starts the event log at the path, or at DEBUG_FNAME in debug builds, which
+// always log, if the path is empty. returns false if the log couldn't start
+bool debug_init(string path)
 {
-	Board output;
-	output.fill(' ');
-	return output;
+#ifdef TTT_DEBUG
+	if (path.empty())
+		path = DEBUG_FNAME;
+#endif
+	if (path.empty() || event_log.start(path.c_str()))
+		return true;
+	cerr << "Cannot write the event log to " << path << endl;
+	return false;
 }
 
-// returns whether the given board is full and needs to be disposed.
-// could've used empty_cells().empty(), but this is simpler
-bool is_full(const Board& board)
+// returns a simplified board with the same cells as the bitboard
+template <class G>
+Board<G> to_board(const BitBoard<G>& board)
 {
-	return find(board.begin(), board.end(), ' ') == board.end();
+	Board<G> output;
+	for (size_t i = 0; i < G::CELLS; ++i) {
+		typename G::Mask cell = typename G::Mask(1) << i;
+		output[i] = board.x & cell ? 'x' :
+		            board.o & cell ? 'o' : ' ';
+	}
+	return output;
 }
 
 // returns a string that represents a certain move.
 string fmt_move(char player, short index)
 {
-	stringstream output;
-	output << 'm' << player << index;
-	return output.str();
+	char output[16];
+	return string(output, write_move(output, player, index));
 }
 
 // returns a string that represents a certain board.
-string board_to_string(const Board& brd)
+template <size_t N>
+string board_to_string(const array<char, N>& brd)
 {
-	stringstream output;
-	for (size_t i = 0; i < 9; ++i) {
-		output << brd[i];
-	}
-	return output.str();
+	return string(brd.data(), N);
 }
 
 /* ========== Algorithms ========== */
@@ -194,114 +140,128 @@ char inverse(char input)
 }
 
 // returns the preferability score for the given board in the perspective of
-// the given player (ismachine)
-short score(const Board& board, bool is_machine)
+// the given player
+template <class G>
+short score(const BitBoard<G>& board, char player)
 {
 	char winner = board_winner(board);
 	if (winner == ' ')
 		return 0;
 
-	return is_machine ? (winner == machine ? 1 : -1) :
-		         (winner == inverse(machine) ? 1 : -1);
+	return winner == player ? 1 : -1;
 }
 
+#include "engine/random.hh"
+
 // returns a random index of the given vector that points to (one of) the largest
-// numbers in it
-unsigned int rand_max_index(const vector<int>& vect)
+// numbers in it, every one equally likely. takes any container of ints, and
+// picks as it goes, so it needs no storage of its own
+template <class C>
+unsigned int rand_max_index(const C& vect, Random& random)
 {
-	vector<unsigned int> occurrences;
 	int largest_occurred = numeric_limits<int>::min();
-
+	unsigned int occurrences = 0, chosen = 0;
 	for (unsigned int i = 0; i < vect.size(); ++i) {
 		if (vect[i] > largest_occurred) {
 			largest_occurred = vect[i];
-			occurrences = {i};
-		} else if (vect[i] == largest_occurred) {
-			occurrences.push_back(i);
+			occurrences = 1;
+			chosen = i;
+		} else if (vect[i] == largest_occurred && random.keep(++occurrences)) {
+			chosen = i;
 		}
 	}
-
-	// suffers from distribution problem, but no uniform distribution required
-	return occurrences[rand() % occurrences.size()];
+	return chosen;
 }
 
-// returns a random index of the given vector that points to (one of) the
-// smallest numbers in it
-unsigned int rand_min_index(const vector<int>& varr)
+// returns a random cell from the non-empty mask
+short random_cell(uint64_t mask, Random& random)
 {
-	vector<unsigned int> occurrences;
-	int smallest_occurred = numeric_limits<int>::max();
-
-	for (unsigned int i = 0; i < varr.size(); ++i) {
-		if (varr[i] < smallest_occurred) {
-			smallest_occurred = varr[i];
-			occurrences = {i};
-		} else if (varr[i] == smallest_occurred) {
-			occurrences.push_back(i);
-		}
-	}
-
-	return occurrences[rand() % occurrences.size()];
+	// drop a random number of the lowest cells, then take the next one
+	for (int skip = random.below(cell_count(mask)); skip > 0; --skip)
+		mask &= mask - 1;
+	return lowest_cell(mask);
 }
 
-// the internal function of MiniMax, called recursively.
-int minimax_internal(Board board, unsigned short depth, bool ismachine)
+#include "engine/metrics.hh"
+#include "engine/batch.hh"
+#include "engine/buffer.hh"
+#include "engine/pool.hh"
+#include "engine/search.hh"
+#include "engine/policy.hh"
+
+// writes out the rest of the event log and exports the metrics one last time,
+// while every global they read is still there
+void debug_exit()
 {
-	short initial_score = score(board, ismachine);
-	if (initial_score != 0) {
-		return initial_score *
-			(ismachine ? 10 - depth : depth - 10);
-	}
-	if (is_full(board))
-		return 0;
+	event_log.stop();
+	metrics_exporter.stop();
+}
 
-	// insertion-ordered mapping from move to score, plus individual vector manipulation
-	// should be at same size at any time except between insertions in loop
-	vector<short> moves;
-	vector<int> scores;
-	Board hypo_board;
-	for (short& _move: empty_cells(board)) {
-		hypo_board = board;
-		hypo_board[_move] = ismachine ? machine : inverse(machine);
-
-		moves.push_back(_move);
-		scores.push_back(minimax_internal(hypo_board, depth+1, !ismachine));
-	}
+// a dumb strategizer, only gets random index from available cells
+template <class G>
+short dumb_strategy(const BitBoard<G>& board, Random& random)
+{
+	return random_cell(empty_mask(board), random);
+}
 
-	unsigned int chosen_index = ismachine ?
-		rand_max_index(scores) : rand_min_index(scores);
-	return scores[chosen_index];
+// a medium strategizer: wins when it can, blocks the opponent's line when it
+// has to, and plays a random cell otherwise
+template <class G>
+short medium_strategy(const BitBoard<G>& board, Random& random)
+{
+	typedef typename G::Mask Mask;
+	Mask own = to_move(board) == 'x' ? board.x : board.o;
+	Mask other = to_move(board) == 'x' ? board.o : board.x;
+	Mask empties = empty_mask(board);
+	Mask wins = winning_cells<G>(own, empties);
+	if (wins)
+		return random_cell(wins, random);
+	Mask blocks = winning_cells<G>(other, empties);
+	return random_cell(blocks ? blocks : empties, random);
 }
 
-// the external function of minimax, returns desired move, or -1 if game over
-// simplified version of minimax_internal
-short minimax(const Board& board)
+// names of the strategies, by difficulty
+const char* const STRATEGY_NAMES[] = {"easy", "medium", "impossible"};
+
+// returns the difficulty of the strategy of the given name, or -1 if unknown
+short parse_strategy(const string& name)
 {
-	if (score(board, true) != 0 ||
-			is_full(board))
-		return -1;
-
-	vector<short> moves;
-	vector<int> scores;
-	Board hypo_board;
-	for (short& _move: empty_cells(board)) {
-		hypo_board = board;
-		hypo_board[_move] = machine;
-
-		moves.push_back(_move);
-		scores.push_back(minimax_internal(hypo_board, 1, false));
+	for (short difficulty = 0; difficulty < 3; ++difficulty) {
+		if (name == STRATEGY_NAMES[difficulty])
+			return difficulty;
 	}
-
-	return moves[rand_max_index(scores)];
+	return -1;
 }
 
-// a dumb strategizer, only gets random index from available cells
-short dumb_strategy(const Board& board)
+// returns the result of the strategy of the difficulty for the player to move,
+// 0 => easy, 1 => medium, 2 => impossible. its move is -1 for any other
+// difficulty. only the impossible strategy searches and scores moves
+template <class G>
+SearchResult strategy_move(short difficulty, const BitBoard<G>& board,
+		SearchLimits& limits)
 {
-	vector<short> empties = empty_cells(board);
-	return empties[ rand() % empties.size() ];
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	short move;
+	switch (difficulty) {
+		case 0:
+			move = dumb_strategy(board, limits.random);
+			break;
+		case 1:
+			move = medium_strategy(board, limits.random);
+			break;
+		case 2:
+			move = minimax(board, limits);
+			break;
+		default:
+			move = -1;
+	}
+	finish_result(limits, move, begin);
+	move_latency.record(limits.result.elapsed_ns);
+	return limits.result;
 }
 
+#include "engine/context.hh"
+
 /* ========== Input/Output protocol and tools ========== */
 
 /* Tic Tac Toe protocol documentation
@@ -317,7 +277,7 @@ short dumb_strategy(const Board& board)
  * 	 -3 = opponent first, impossible
  *
  * 1 => what cell
- *   (index 0-8)
+ *   (index 0-8 on the classic board, row by row)
  *
  * 2 => this is thinking
  *
@@ -352,12 +312,24 @@ pair<bool, short> parse_whofirst_response(short resp)
 	return make_pair<bool, short>( resp > 0, abs(resp) - 1 );
 }
 
+// prints a border row of a drawn board of the given width, e.g. "┌───┬───┬───┐"
+void grid_border(ostream& out, unsigned width, const char* left,
+		const char* middle, const char* right)
+{
+	out << left;
+	for (unsigned i = 0; i < width; ++i)
+		out << (i == 0 ? "" : middle) << "───";
+	out << right;
+}
+
 // optional implementations by headers
 void proto_init();
 short proto_out(short proto);
 short proto_query(short proto_out);
-Board board_in();
-short board_out(const Board& brd);
+template <class G>
+Board<G> board_in();
+template <class G>
+short board_out(const Board<G>& brd, char machine);
 
 // Include the communication header here.
 
@@ -370,22 +342,59 @@ short board_out(const Board& brd);
 
 /* ========== Time Profiling ========== */
 
-chrono::time_point<chrono::system_clock> time_at_begin;
+#ifdef COMPILE_PROFILE
+#include "engine/perf.hh"
+#endif
+
+chrono::steady_clock::time_point time_at_begin;
 string time_profile_name;
 
+#if defined(COMPILE_PROFILE) || defined(COMPILE_BENCH)
+// every heap allocation of the program goes through the operator new below,
+// which counts it. the array forms of new and delete call these
+atomic<unsigned long> heap_allocations(0);
+unsigned long heap_allocations_at_begin;
+
+void* operator new(size_t size)
+{
+	++heap_allocations;
+	if (void* memory = malloc(size ? size : 1))
+		return memory;
+	throw bad_alloc();
+}
+
+// kept out of line, or GCC sees free() of memory from operator new inlined
+// into callers and warns of a mismatch
+__attribute__((noinline))
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+__attribute__((noinline))
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+#endif
+
 void timer_begin(const string& profname)
 {
 #ifdef COMPILE_PROFILE
-	time_at_begin = chrono::system_clock::now();
+	time_at_begin = chrono::steady_clock::now();
 	time_profile_name = profname;
+	heap_allocations_at_begin = heap_allocations;
+	// read last, so that the phase counts as little of the profiling as it can
+	perf_begin();
 #endif
 }
 
+// returns the nanoseconds elapsed since timer_begin
 long timer_stop()
 {
 #ifdef COMPILE_PROFILE
-	return chrono::duration_cast<chrono::milliseconds>
-		(chrono::system_clock::now() - time_at_begin).count();
+	return chrono::duration_cast<chrono::nanoseconds>
+		(chrono::steady_clock::now() - time_at_begin).count();
 #else
 	return -1;
 #endif
@@ -395,45 +404,102 @@ long timer_stop()
 void timer_report_info()
 {
 #ifdef COMPILE_PROFILE
+	// counted first, so that the printing below doesn't count
+	perf_stop();
+	unsigned long allocations = heap_allocations - heap_allocations_at_begin;
 	cout << termcolor::green << "Profiling: phase '" << time_profile_name
-		<< "' completed in " << timer_stop() << "ms" << endl << termcolor::reset;
+		<< "' completed in " << timer_stop() << "ns with " << allocations
+		<< " heap allocations" << endl;
+	perf_report(cout);
+	cout << termcolor::reset;
+#endif
+}
+
+// returns the result of a decision on one line: the move and its score, the
+// score of every move searched, and what the search took
+string result_to_string(const SearchResult& result)
+{
+	ostringstream sstr;
+	sstr << "move=" << result.move << " score=" << result.score << " depth="
+		<< result.depth_reached << (result.exact ? " (exact)" : " (estimated)")
+		<< " scores=";
+	if (!result.scored_moves)
+		sstr << "-";
+	for (uint64_t moves = result.scored_moves; moves; moves &= moves - 1) {
+		unsigned short move = lowest_cell(moves);
+		sstr << move << ":" << result.scores[move] <<
+			(moves & (moves - 1) ? "," : "");
+	}
+	sstr << " nodes=" << result.nodes << " leaves=" << result.leaves
+		<< " max_depth=" << result.max_depth << " tt_hits=" << result.tt_hits
+		<< " tt_probes=" << result.tt_probes << " elapsed=" << result.elapsed_ns
+		<< "ns";
+	return sstr.str();
+}
+
+// prints the result of the machine's decision in profile builds, and logs it
+void result_report_info(const SearchResult& result)
+{
+#ifdef COMPILE_PROFILE
+	cout << termcolor::green << "Profiling: " << result_to_string(result) << endl
+		<< termcolor::reset;
 #endif
+	log_event(LOG_RESULT, 0, result.move);
+	log_event(LOG_SCORE, 0, result.score);
+	log_event(LOG_DEPTH, 0, result.depth_reached);
+	log_event(LOG_NODES, 0, int32_t(min(result.nodes, 0x7fffffffUL)));
+	log_event(LOG_ELAPSED, 0, int32_t(min(result.elapsed_ns / 1000, uint64_t(0x7fffffff))));
 }
 
+#include "comm/journal.hh"
+
 /* ========== Interactive ========== */
 
-void play_game(bool machine_first, short difficulty)
+// how the machine plays: the difficulty, the milliseconds and nodes it may
+// search each move (0 for no limit), and the seed of its random choices. the
+// same seed replays the same game against the same moves, as long as the
+// search is bounded by nodes on one thread rather than by time
+struct GameSettings {
+	short difficulty;
+	long move_time;
+	unsigned long move_nodes;
+	uint64_t seed;
+};
+
+template <class G>
+void play_game(bool machine_first, const GameSettings& settings)
 {
 	// prepare game by defining turn variables and obtaining clean board
-	machine = machine_first ? 'x' : 'o';
+	char machine = machine_first ? 'x' : 'o';
+	EngineContext engine(machine, settings.difficulty, settings.move_time,
+			settings.move_nodes, settings.seed);
 	char whose_turn = 'x';
-	Board brd = clean_board();
+	BitBoard<G> brd = clean_board<G>();
+	JournalRecord<G> record = journal_record<G>(settings.seed, settings.difficulty,
+			machine);
+	games_active.add(1);
 
 	// main game loop
-	while (score(brd, true) == 0 &&
+	while (score(brd, machine) == 0 &&
 	       !is_full(brd)) {
 
 		// present the game to the player
-		board_out(brd);
+		board_out<G>(to_board(brd), machine);
 		// obtain decisions
 		if (whose_turn == machine) {
 			proto_out(PROTO_IMTHINKING);
-			unsigned short machine_decision;
 			timer_begin("Machine decision");
-			switch (difficulty) {
-				case 0:
-					machine_decision = dumb_strategy(brd);
-					break;
-				case 2:
-					machine_decision = minimax(brd);
-					break;
-				default:
-					cerr << "Bad difficulty!" << endl;
-					return;
+			short machine_decision = best_move(engine, brd);
+			if (machine_decision < 0) {
+				cerr << "Bad difficulty!" << endl;
+				games_active.add(-1);
+				return;
 			}
 			timer_report_info();
-			brd[machine_decision] = machine;
-			debug_write("move: " + fmt_move(machine, machine_decision));
+			result_report_info(engine.last);
+			place(brd, machine, machine_decision);
+			log_event(LOG_MOVE, machine, machine_decision, brd);
+			journal_move(record, machine_decision, engine.last.elapsed_ns);
 
 		} else {
 			// Goto is bad for readability, but it's in the proximity, so bear with it.
@@ -442,19 +508,25 @@ wait_user_choice:
 			short user_choice = proto_query(PROTO_WHATCELL);
 
 			// we don't trust the player
-			if (brd[user_choice] != ' ') {
+			if (user_choice < 0 || user_choice >= short(G::CELLS) ||
+					!(empty_mask(brd) & (typename G::Mask(1) << user_choice))) {
 				proto_out(PROTO_BADCHOICE);
 				goto wait_user_choice;
 			}
-			brd[user_choice] = inverse(machine);
-			debug_write("move: " + fmt_move(inverse(machine), user_choice));
+			place(brd, inverse(machine), user_choice);
+			log_event(LOG_MOVE, inverse(machine), user_choice, brd);
+			journal_move(record, user_choice, 0);
 		}
 		proto_out(PROTO_FINECHOICE);
 		whose_turn = inverse(whose_turn);
-		debug_write("board: " + board_to_string(brd));
 	}
 	proto_out(PROTO_GAMEDONE);
+	games_active.add(-1);
+	++games_played;
 	char winner = board_winner(brd);
+	record.winner = winner;
+	if (game_journal.active())
+		game_journal.append(record);
 	if (winner == machine) {
 		proto_out(PROTO_IWIN);
 	} else if (winner == ' ') {
@@ -462,44 +534,264 @@ wait_user_choice:
 	} else {
 		proto_out(PROTO_UWIN);
 	}
-	board_out(brd);
+	board_out<G>(to_board(brd), machine);
+}
+
+// prints the chart of cell indexes, then plays a game on the board
+template <class G>
+void play_board(bool machine_first, const GameSettings& settings)
+{
+	cout << termcolor::cyan << termcolor::bold <<
+		"When inputting choice, follow this chart for desired cell:\n";
+	grid_border(cout, G::WIDTH, "┌", "┬", "┐");
+	cout << '\n';
+	for (unsigned row = 0; row < G::HEIGHT; ++row) {
+		if (row > 0) {
+			grid_border(cout, G::WIDTH, "├", "┼", "┤");
+			cout << '\n';
+		}
+		cout << "│";
+		for (unsigned col = 0; col < G::WIDTH; ++col)
+			cout << setw(2) << row * G::WIDTH + col << " │";
+		cout << '\n';
+	}
+	grid_border(cout, G::WIDTH, "└", "┴", "┘");
+	cout << '\n' << termcolor::reset << flush;
+	play_game<G>(machine_first, settings);
 }
 
+#include "comm/analyze.hh"
+#include "comm/selfplay.hh"
+#ifdef COMPILE_BENCH
+#include "comm/bench.hh"
+#endif
+#ifdef COMPILE_SOCKET
+#include "comm/sockcomm.hh"
+#endif
+#ifdef COMPILE_LIBRARY
+#include "comm/library.hh"
+#endif
+
 /* ========== Main Routine ========== */
 
+// a library build is loaded by other programs, which have their own main
+#ifndef COMPILE_LIBRARY
+
 // all prompts should be yellow
 int main(int argc, const char** argv)
 {
-	debug_init();
+	// board to play on, given as --board WIDTHxHEIGHTxLENGTH, the
+	// milliseconds and nodes the machine may search per move (0 for no limit),
+	// the seed of its random choices (the clock by default), and the threads
+	// it searches with (0 for one per hardware thread). --analyze FILE (- for
+	// stdin) analyzes the positions in the file instead of playing, read as
+	// text or as given by --analyze-format. --selfplay GAMES plays that many
+	// games between the strategies given as --players FIRST:SECOND instead.
+	// --metrics FILE (or unix:PATH for a Unix socket) exports the metrics
+	// there every --metrics-interval seconds. --serve PORT hosts games over
+	// TCP instead, in builds with COMPILE_SOCKET, with the protocol given as
+	// --protocol bytes or framed. --log FILE writes the event log there, and
+	// --decode-log FILE (- for stdin) prints a log as text instead of playing.
+	// --journal FILE appends a record of each game played there, and
+	// --journal-stats FILE, given once per journal, prints the statistics of
+	// the journals instead of playing
+	string board_shape = "3x3x3";
+	string analyze_path, analyze_format = "text";
+	unsigned long selfplay_games = 0;
+	string players = "impossible:impossible";
+	string metrics_target;
+	double metrics_interval = 10;
+	unsigned long serve_port = 0;
+	string protocol = "bytes";
+	string log_path, decode_path;
+	string journal_path;
+	vector<string> journal_stats_paths;
+	GameSettings settings;
+	settings.move_time = 1000;
+	settings.move_nodes = 0;
+	settings.seed = chrono::system_clock::now().time_since_epoch().count();
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (string(argv[i]) == "--board")
+			board_shape = argv[i + 1];
+		else if (string(argv[i]) == "--move-time")
+			settings.move_time = atol(argv[i + 1]);
+		else if (string(argv[i]) == "--move-nodes")
+			settings.move_nodes = strtoul(argv[i + 1], NULL, 10);
+		else if (string(argv[i]) == "--seed")
+			settings.seed = strtoull(argv[i + 1], NULL, 10);
+		else if (string(argv[i]) == "--threads")
+			search_threads = strtoul(argv[i + 1], NULL, 10);
+		else if (string(argv[i]) == "--analyze")
+			analyze_path = argv[i + 1];
+		else if (string(argv[i]) == "--analyze-format")
+			analyze_format = argv[i + 1];
+		else if (string(argv[i]) == "--selfplay")
+			selfplay_games = strtoul(argv[i + 1], NULL, 10);
+		else if (string(argv[i]) == "--players")
+			players = argv[i + 1];
+		else if (string(argv[i]) == "--metrics")
+			metrics_target = argv[i + 1];
+		else if (string(argv[i]) == "--metrics-interval")
+			metrics_interval = atof(argv[i + 1]);
+		else if (string(argv[i]) == "--serve")
+			serve_port = strtoul(argv[i + 1], NULL, 10);
+		else if (string(argv[i]) == "--protocol")
+			protocol = argv[i + 1];
+		else if (string(argv[i]) == "--log")
+			log_path = argv[i + 1];
+		else if (string(argv[i]) == "--decode-log")
+			decode_path = argv[i + 1];
+		else if (string(argv[i]) == "--journal")
+			journal_path = argv[i + 1];
+		else if (string(argv[i]) == "--journal-stats")
+			journal_stats_paths.push_back(argv[i + 1]);
+	}
+	if (board_shape != "3x3x3" && board_shape != "4x4x4" &&
+			board_shape != "5x5x4" && board_shape != "7x7x5") {
+		cerr << "Unsupported board " << board_shape
+			<< ", expected one of 3x3x3, 4x4x4, 5x5x4, 7x7x5" << endl;
+		return 1;
+	}
+
+	if (!decode_path.empty()) {
+		FILE* in = decode_path == "-" ? stdin : fopen(decode_path.c_str(), "rb");
+		if (!in || !decode_log(in, stdout)) {
+			cerr << "Cannot read the event log " << decode_path << endl;
+			return 1;
+		}
+		return 0;
+	}
+	if (!journal_stats_paths.empty())
+		return journal_report(journal_stats_paths);
+	if (!journal_path.empty()) {
+		bool opened;
+		if (board_shape == "3x3x3")
+			opened = game_journal.open<Classic>(journal_path);
+		else if (board_shape == "4x4x4")
+			opened = game_journal.open<Geometry<4, 4, 4> >(journal_path);
+		else if (board_shape == "5x5x4")
+			opened = game_journal.open<Geometry<5, 5, 4> >(journal_path);
+		else
+			opened = game_journal.open<Geometry<7, 7, 5> >(journal_path);
+		if (!opened)
+			return 1;
+	}
+	if (!debug_init(log_path))
+		return 1;
+
+	if (!metrics_target.empty())
+		metrics_exporter.start(metrics_target, chrono::milliseconds(
+				max(long(metrics_interval * 1000), 1L)));
+
+#ifdef COMPILE_BENCH
+	// the benchmarks fix their own boards, and only take --threads
+	int status = run_benchmarks();
+	debug_exit();
+	return status;
+#endif
+
+	if (!analyze_path.empty()) {
+		if (analyze_format != "text" && analyze_format != "packed") {
+			cerr << "Unsupported format " << analyze_format
+				<< ", expected text or packed" << endl;
+			return 1;
+		}
+		FILE* in = analyze_path == "-" ? stdin :
+			fopen(analyze_path.c_str(), analyze_format == "packed" ? "rb" : "r");
+		if (!in) {
+			cerr << "Cannot open " << analyze_path << endl;
+			return 1;
+		}
+		bool packed = analyze_format == "packed";
+		unsigned long invalid;
+		if (board_shape == "3x3x3")
+			invalid = analyze_positions<Classic>(in, stdout, packed, settings);
+		else if (board_shape == "4x4x4")
+			invalid = analyze_positions<Geometry<4, 4, 4> >(in, stdout, packed, settings);
+		else if (board_shape == "5x5x4")
+			invalid = analyze_positions<Geometry<5, 5, 4> >(in, stdout, packed, settings);
+		else
+			invalid = analyze_positions<Geometry<7, 7, 5> >(in, stdout, packed, settings);
+		if (invalid)
+			cerr << invalid << " invalid positions" << endl;
+		debug_exit();
+		return 0;
+	}
+
+	if (serve_port) {
+#ifdef COMPILE_SOCKET
+		if (protocol != "bytes" && protocol != "framed") {
+			cerr << "Unsupported protocol " << protocol
+				<< ", expected bytes or framed" << endl;
+			return 1;
+		}
+		bool framed = protocol == "framed";
+		if (board_shape == "3x3x3")
+			serve_games<Classic>(serve_port, settings, framed);
+		else if (board_shape == "4x4x4")
+			serve_games<Geometry<4, 4, 4> >(serve_port, settings, framed);
+		else if (board_shape == "5x5x4")
+			serve_games<Geometry<5, 5, 4> >(serve_port, settings, framed);
+		else
+			serve_games<Geometry<7, 7, 5> >(serve_port, settings, framed);
+		debug_exit();
+		return 0;
+#else
+		cerr << "Serving needs a build with COMPILE_SOCKET" << endl;
+		return 1;
+#endif
+	}
+
+	if (selfplay_games) {
+		size_t colon = players.find(':');
+		short strategies[2] = {parse_strategy(players.substr(0, colon)),
+			colon == string::npos ? short(-1) :
+				parse_strategy(players.substr(colon + 1))};
+		if (strategies[0] < 0 || strategies[1] < 0) {
+			cerr << "Unsupported players " << players << ", expected FIRST:SECOND"
+				<< " of easy, medium, impossible" << endl;
+			return 1;
+		}
+		if (board_shape == "3x3x3")
+			selfplay<Classic>(selfplay_games, strategies, settings);
+		else if (board_shape == "4x4x4")
+			selfplay<Geometry<4, 4, 4> >(selfplay_games, strategies, settings);
+		else if (board_shape == "5x5x4")
+			selfplay<Geometry<5, 5, 4> >(selfplay_games, strategies, settings);
+		else
+			selfplay<Geometry<7, 7, 5> >(selfplay_games, strategies, settings);
+		debug_exit();
+		return 0;
+	}
+
 #ifdef TTT_DEBUG
 	cout << termcolor::red << "Tic-Tac-Toe Debug is enabled!" << endl;
 #endif
 #ifdef COMPILE_PROFILE
 	cout << termcolor::red << "Time profiling is enabled!" << endl;
 #endif
+
 	cout << termcolor::green << "Hello player!" << termcolor::reset << endl;
 
 	bool machine_first;
-	short difficulty;
 	{
 		// parse difficulty and who first in a block to ensure `pair` deletion.
 		pair<bool, short> parsed_fd =
 			parse_whofirst_response(proto_query(PROTO_WHOFIRST));
 		machine_first = parsed_fd.first;
-		difficulty = parsed_fd.second;
+		settings.difficulty = parsed_fd.second;
 	}
 
-	srand(chrono::system_clock::now().time_since_epoch().count());
-	// helper
-	cout << termcolor::cyan << termcolor::bold <<
-		"When inputting choice, follow this chart for desired cell:" << endl
-		<< "┌───┬───┬───┐" << endl
-		<< "│ 0 │ 1 │ 2 │" << endl
-		<< "├───┼───┼───┤" << endl
-		<< "│ 3 │ 4 │ 5 │" << endl
-		<< "├───┼───┼───┤" << endl
-		<< "│ 6 │ 7 │ 8 │" << endl
-		<< "└───┴───┴───┘" << endl << termcolor::reset;
-	play_game(machine_first, difficulty);
+	// start the search threads now rather than during the first move
+	search_pool();
+	if (board_shape == "3x3x3")
+		play_board<Classic>(machine_first, settings);
+	else if (board_shape == "4x4x4")
+		play_board<Geometry<4, 4, 4> >(machine_first, settings);
+	else if (board_shape == "5x5x4")
+		play_board<Geometry<5, 5, 4> >(machine_first, settings);
+	else
+		play_board<Geometry<7, 7, 5> >(machine_first, settings);
 	debug_exit();
 }
+#endif